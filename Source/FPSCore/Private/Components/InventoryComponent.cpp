@@ -145,17 +145,17 @@ void UInventoryComponent::SwapWeapon(const int SlotId)
 	// Disabling the currently equipped weapon, if it exists
     if (CurrentWeapon)
     {
-        CurrentWeapon->PrimaryActorTick.bCanEverTick = false;
         CurrentWeapon->SetActorHiddenInGame(true);
         CurrentWeapon->StopFire();
+        CurrentWeapon->OnHolstered();
     }
 
 	// Swapping to the new weapon, enabling it and playing it's equip animation
     CurrentWeapon = EquippedWeapons[SlotId];
     if (CurrentWeapon)
     {
-        CurrentWeapon->PrimaryActorTick.bCanEverTick = true;
         CurrentWeapon->SetActorHiddenInGame(false);
+        CurrentWeapon->OnEquipped();
     	CurrentWeapon->SetCanFire(true);
         if (CurrentWeapon->GetStaticWeaponData()->WeaponEquip)
         {
@@ -222,14 +222,15 @@ void UInventoryComponent::UpdateWeapon(const TSubclassOf<AWeaponBase> NewWeapon,
     	}
         SpawnedWeapon->SetRuntimeWeaponData(DataStruct);
         SpawnedWeapon->SpawnAttachments();
+        SpawnedWeapon->BeginWarmUp();
         EquippedWeapons.Add(InventoryPosition, SpawnedWeapon);
 
 		// Disabling the currently equipped weapon, if it exists
         if (CurrentWeapon)
         {
-            CurrentWeapon->PrimaryActorTick.bCanEverTick = false;
             CurrentWeapon->SetActorHiddenInGame(true);
         	CurrentWeapon->StopFire();
+        	CurrentWeapon->OnHolstered();
         }
 
     	
@@ -239,8 +240,8 @@ void UInventoryComponent::UpdateWeapon(const TSubclassOf<AWeaponBase> NewWeapon,
         
         if (CurrentWeapon)
         {
-            CurrentWeapon->PrimaryActorTick.bCanEverTick = true;
             CurrentWeapon->SetActorHiddenInGame(false);
+            CurrentWeapon->OnEquipped();
             if (CurrentWeapon->GetStaticWeaponData()->WeaponEquip)
             {
             	if (AFPSCharacter* FPSCharacter = Cast<AFPSCharacter>(GetOwner()))
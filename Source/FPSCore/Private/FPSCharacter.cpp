@@ -136,8 +136,7 @@ void AFPSCharacter::Look(const FInputActionValue& Value)
         if (Value.GetMagnitude() != 0.0f && InventoryComponent->GetCurrentWeapon())
         {
             // If movement is detected and we have a current weapon, make sure we don't recover the recoil
-            InventoryComponent->GetCurrentWeapon()->SetShouldRecover(false);
-            InventoryComponent->GetCurrentWeapon()->GetRecoilRecoveryTimeline()->Stop();
+            InventoryComponent->GetCurrentWeapon()->StopRecoilRecovery();
         }
     }
 }
@@ -584,11 +583,35 @@ void AFPSCharacter::SetMovementState(const EMovementState NewMovementState)
     }
 }
 
+FRotator AFPSCharacter::GetAimRotationAtTime(const double Time) const
+{
+    const AFPSCharacterController* FPSController = Cast<AFPSCharacterController>(GetController());
+    if (!FPSController)
+    {
+        // Without a controller that tracks the frame's input, the live control rotation is the best we have
+        return GetControlRotation();
+    }
+
+    // Within the current frame, the controller turns the rotation that the frame started with by the look input
+    // received up to that point, then adds the recoil of the shots already fired. Using the live control rotation here
+    // instead would count earlier kicks twice once the view has been turned
+    const double DeltaSeconds = GetWorld()->GetDeltaSeconds();
+    const double FrameStart = GetWorld()->GetTimeSeconds() - DeltaSeconds;
+    const float Alpha = DeltaSeconds > 0.0 ? static_cast<float>(FMath::Clamp((Time - FrameStart) / DeltaSeconds, 0.0, 1.0)) : 1.0f;
+    return FPSController->GetAimRotationInFrame(Alpha);
+}
+
 // Called every frame
 void AFPSCharacter::Tick(const float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+    // Recovering from recoil once this frame's shots have kicked the view
+    if (InventoryComponent && InventoryComponent->GetCurrentWeapon())
+    {
+        InventoryComponent->GetCurrentWeapon()->UpdateRecoilRecovery(DeltaTime);
+    }
+
     // Timeline tick
     VaultTimeline.TickTimeline(DeltaTime);
 
@@ -2,3 +2,49 @@
 
 #include "FPSCharacterController.h"
 #include "Engine/World.h"
+
+void AFPSCharacterController::AddRecoilInput(const float Pitch, const float Yaw)
+{
+	// Scaling the kick through the look input functions, then holding it back from the rotation input until the view is
+	// next turned. Kicks from shots fired after this frame's view update are then applied by the next one, rather than
+	// depending on when the rotation input is cleared
+	const FRotator PreviousInput = RotationInput;
+	AddPitchInput(Pitch);
+	AddYawInput(Yaw);
+	PendingRecoilInput += RotationInput - PreviousInput;
+	RotationInput = PreviousInput;
+}
+
+FRotator AFPSCharacterController::GetAimRotationInFrame(const float Alpha) const
+{
+	// Look input is spread evenly across the frame, while recoil is added in full: every kick so far came from a shot
+	// fired before this point. Until the view has been turned this frame, the control rotation is still the rotation
+	// that the frame started with and the rotation input holds the look input received so far
+	if (RotationUpdateFrame == GFrameCounter)
+	{
+		return FrameStartRotation + FrameLookInput * Alpha + FrameRecoilInput + PendingRecoilInput;
+	}
+	return GetControlRotation() + RotationInput * Alpha + PendingRecoilInput;
+}
+
+void AFPSCharacterController::UpdateRotation(const float DeltaTime)
+{
+	// Input has been processed by now, so the trigger is up to date. Firing the shots that are due before the view is
+	// turned means that their recoil is applied by this update, and is in this frame's camera
+	if (AWeaponBase* Weapon = ActiveWeapon.Get())
+	{
+		Weapon->AdvanceFireClock(DeltaTime);
+	}
+
+	// Remembering what the view was turned by, so that shots fired later this frame can still reconstruct their aim
+	FrameStartRotation = GetControlRotation();
+	FrameLookInput = RotationInput;
+	FrameRecoilInput = PendingRecoilInput;
+	RotationUpdateFrame = GFrameCounter;
+
+	// Turning the view by the recoil along with the look input, through the camera manager's view rotation processing
+	RotationInput += PendingRecoilInput;
+	PendingRecoilInput = FRotator::ZeroRotator;
+
+	Super::UpdateRotation(DeltaTime);
+}
@@ -0,0 +1,49 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "RecoilCameraModifier.h"
+#include "Camera/PlayerCameraManager.h"
+
+void URecoilCameraModifier::AddKick(const FRotator& Impulse, const float Frequency)
+{
+	Velocity += FVector(Impulse.Pitch, Impulse.Yaw, Impulse.Roll);
+	SpringFrequency = FMath::Max(Frequency, UE_KINDA_SMALL_NUMBER);
+}
+
+URecoilCameraModifier* URecoilCameraModifier::FindOrAdd(APlayerCameraManager* CameraManager)
+{
+	if (!CameraManager)
+	{
+		return nullptr;
+	}
+
+	if (URecoilCameraModifier* Modifier = Cast<URecoilCameraModifier>(CameraManager->FindCameraModifierByClass(StaticClass())))
+	{
+		return Modifier;
+	}
+	return Cast<URecoilCameraModifier>(CameraManager->AddNewCameraModifier(StaticClass()));
+}
+
+bool URecoilCameraModifier::ModifyCamera(const float DeltaTime, FMinimalViewInfo& InOutPOV)
+{
+	Super::ModifyCamera(DeltaTime, InOutPOV);
+
+	if (Offset.IsNearlyZero(0.001) && Velocity.IsNearlyZero(0.001))
+	{
+		Offset = FVector::ZeroVector;
+		Velocity = FVector::ZeroVector;
+		return false;
+	}
+
+	// Advancing the critically damped spring by its exact solution, so that the kick settles the same way at any
+	// frame rate
+	const double Omega = SpringFrequency;
+	const double Decay = FMath::Exp(-Omega * DeltaTime);
+	const FVector C = Velocity + Offset * Omega;
+	Offset = (Offset + C * DeltaTime) * Decay;
+	Velocity = (Velocity - C * (Omega * DeltaTime)) * Decay;
+
+	InOutPOV.Rotation += FRotator(Offset.X, Offset.Y, Offset.Z) * Alpha;
+
+	// Letting the modifiers after this one carry on
+	return false;
+}
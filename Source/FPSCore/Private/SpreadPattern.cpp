@@ -0,0 +1,203 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "SpreadPattern.h"
+#include "Math/RandomStream.h"
+#include "Math/RotationMatrix.h"
+#include "Math/VectorRegister.h"
+
+void USpreadPattern::TransformPattern(const FRotator& AimRotation, const float SpreadX, const float SpreadY,
+                                      const float Roll, const int32 NumPellets,
+                                      TArray<FVector, TInlineAllocator<16>>& OutDirections) const
+{
+	OutDirections.Reset();
+
+	const int32 NumPatternPoints = Points.Num();
+	if (NumPatternPoints == 0 || NumPellets <= 0)
+	{
+		return;
+	}
+
+	// Reading past the baked buffers would be far worse than a shot without spread
+	if (!ensureMsgf(OffsetsX.Num() == Align(NumPatternPoints, 4), TEXT("Spread pattern %s was changed without being baked"), *GetName()))
+	{
+		return;
+	}
+
+	// The aim basis is the only trigonometry needed for the whole shot
+	const FRotationMatrix AimMatrix(AimRotation);
+	const FVector3f Forward(AimMatrix.GetScaledAxis(EAxis::X));
+	const FVector3f Right(AimMatrix.GetScaledAxis(EAxis::Y));
+	const FVector3f Up(AimMatrix.GetScaledAxis(EAxis::Z));
+
+	const VectorRegister4Float Fx = VectorSetFloat1(Forward.X);
+	const VectorRegister4Float Fy = VectorSetFloat1(Forward.Y);
+	const VectorRegister4Float Fz = VectorSetFloat1(Forward.Z);
+	const VectorRegister4Float Rx = VectorSetFloat1(Right.X);
+	const VectorRegister4Float Ry = VectorSetFloat1(Right.Y);
+	const VectorRegister4Float Rz = VectorSetFloat1(Right.Z);
+	const VectorRegister4Float Ux = VectorSetFloat1(Up.X);
+	const VectorRegister4Float Uy = VectorSetFloat1(Up.Y);
+	const VectorRegister4Float Uz = VectorSetFloat1(Up.Z);
+
+	float SinRoll, CosRoll;
+	FMath::SinCos(&SinRoll, &CosRoll, Roll);
+	const VectorRegister4Float Sin = VectorSetFloat1(SinRoll);
+	const VectorRegister4Float Cos = VectorSetFloat1(CosRoll);
+	const VectorRegister4Float ScaleX = VectorSetFloat1(SpreadX);
+	const VectorRegister4Float ScaleY = VectorSetFloat1(SpreadY);
+
+	const int32 NumUnique = FMath::Min(NumPatternPoints, NumPellets);
+	OutDirections.SetNumUninitialized(NumPellets);
+
+	// Transforming four points at a time: each offset is rotated by the roll, scaled by the spread and then projected
+	// onto the plane in front of the aim, before being normalised. The buffers are padded, so the last block is safe
+	const float* RESTRICT X = OffsetsX.GetData();
+	const float* RESTRICT Y = OffsetsY.GetData();
+	for (int32 Index = 0; Index < NumUnique; Index += 4)
+	{
+		const VectorRegister4Float PointX = VectorLoad(X + Index);
+		const VectorRegister4Float PointY = VectorLoad(Y + Index);
+
+		const VectorRegister4Float OffsetRight = VectorMultiply(VectorNegateMultiplyAdd(PointY, Sin, VectorMultiply(PointX, Cos)), ScaleX);
+		const VectorRegister4Float OffsetUp = VectorMultiply(VectorMultiplyAdd(PointX, Sin, VectorMultiply(PointY, Cos)), ScaleY);
+
+		VectorRegister4Float Dx = VectorMultiplyAdd(OffsetRight, Rx, VectorMultiplyAdd(OffsetUp, Ux, Fx));
+		VectorRegister4Float Dy = VectorMultiplyAdd(OffsetRight, Ry, VectorMultiplyAdd(OffsetUp, Uy, Fy));
+		VectorRegister4Float Dz = VectorMultiplyAdd(OffsetRight, Rz, VectorMultiplyAdd(OffsetUp, Uz, Fz));
+
+		const VectorRegister4Float InvLength = VectorReciprocalSqrt(VectorMultiplyAdd(Dx, Dx, VectorMultiplyAdd(Dy, Dy, VectorMultiply(Dz, Dz))));
+		Dx = VectorMultiply(Dx, InvLength);
+		Dy = VectorMultiply(Dy, InvLength);
+		Dz = VectorMultiply(Dz, InvLength);
+
+		float OutX[4], OutY[4], OutZ[4];
+		VectorStore(Dx, OutX);
+		VectorStore(Dy, OutY);
+		VectorStore(Dz, OutZ);
+
+		const int32 NumLanes = FMath::Min(4, NumUnique - Index);
+		for (int32 Lane = 0; Lane < NumLanes; ++Lane)
+		{
+			OutDirections[Index + Lane] = FVector(OutX[Lane], OutY[Lane], OutZ[Lane]);
+		}
+	}
+
+	// Repeating the pattern if the weapon fires more pellets than it has points
+	for (int32 Index = NumUnique; Index < NumPellets; ++Index)
+	{
+		OutDirections[Index] = OutDirections[Index % NumUnique];
+	}
+}
+
+void USpreadPattern::BakePoints()
+{
+	const int32 NumPadded = Align(Points.Num(), 4);
+	OffsetsX.SetNumZeroed(NumPadded);
+	OffsetsY.SetNumZeroed(NumPadded);
+
+	for (int32 Index = 0; Index < Points.Num(); ++Index)
+	{
+		// Keeping every point within the unit disk, so that the weapon's spread is always the outer edge of the pattern
+		const FVector2D Point = Points[Index].GetSafeNormal() * FMath::Min(Points[Index].Size(), 1.0);
+		OffsetsX[Index] = static_cast<float>(Point.X);
+		OffsetsY[Index] = static_cast<float>(Point.Y);
+	}
+}
+
+void USpreadPattern::SetPoints(const TArray<FVector2D>& NewPoints)
+{
+	Points = NewPoints;
+	BakePoints();
+}
+
+void USpreadPattern::PostLoad()
+{
+	Super::PostLoad();
+
+	BakePoints();
+}
+
+void USpreadPattern::PostDuplicate(const bool bDuplicateForPIE)
+{
+	Super::PostDuplicate(bDuplicateForPIE);
+
+	// Only the points are duplicated, as the baked buffers aren't properties
+	BakePoints();
+}
+
+#if WITH_EDITOR
+void USpreadPattern::GenerateRings()
+{
+	Modify();
+	Points.Reset();
+	Points.Add(FVector2D::ZeroVector);
+
+	for (int32 Ring = 1; Ring <= NumRings; ++Ring)
+	{
+		const int32 NumRingPoints = Ring * PointsPerRing;
+		const double Radius = static_cast<double>(Ring) / NumRings;
+		// Offsetting every other ring by half a step so that the rings' points don't line up
+		const double AngleOffset = (Ring % 2 == 0) ? PI / NumRingPoints : 0.0;
+
+		for (int32 Point = 0; Point < NumRingPoints; ++Point)
+		{
+			const double Angle = AngleOffset + 2.0 * PI * Point / NumRingPoints;
+			Points.Add(FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * Radius);
+		}
+	}
+
+	BakePoints();
+	MarkPackageDirty();
+}
+
+void USpreadPattern::GeneratePoissonDisk()
+{
+	Modify();
+	Points.Reset();
+
+	// Dart throwing: points are rejected if they fall too close to an existing one, and the minimum distance is relaxed
+	// whenever too many darts in a row are rejected
+	const FRandomStream Stream(GenerationSeed);
+	double MinDistance = 1.6 / FMath::Sqrt(static_cast<double>(NumPoints));
+	int32 Rejections = 0;
+
+	while (Points.Num() < NumPoints)
+	{
+		const double Angle = Stream.FRandRange(0.0f, 2.0f * PI);
+		const FVector2D Candidate = FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)) * FMath::Sqrt(Stream.FRand());
+
+		const bool bTooClose = Points.ContainsByPredicate([&Candidate, MinDistance](const FVector2D& Point)
+		{
+			return FVector2D::DistSquared(Point, Candidate) < MinDistance * MinDistance;
+		});
+
+		if (!bTooClose)
+		{
+			Points.Add(Candidate);
+			Rejections = 0;
+		}
+		else if (++Rejections > 64)
+		{
+			MinDistance *= 0.9;
+			Rejections = 0;
+		}
+	}
+
+	BakePoints();
+	MarkPackageDirty();
+}
+
+void USpreadPattern::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	BakePoints();
+}
+
+void USpreadPattern::PostEditUndo()
+{
+	Super::PostEditUndo();
+
+	BakePoints();
+}
+#endif
@@ -0,0 +1,132 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/CosmeticSchedulerSubsystem.h"
+#include "FPSCore.h"
+#include "WeaponBase.h"
+#include "Algo/StableSort.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTime.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cosmetic Scheduler Drain"), STAT_CosmeticSchedulerDrain, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cosmetics Played"), STAT_CosmeticsPlayed, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cosmetics Deferred"), STAT_CosmeticsDeferred, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cosmetics Dropped"), STAT_CosmeticsDropped, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<float> CVarCosmeticsBudgetMs(
+	TEXT("fps.Cosmetics.BudgetMs"),
+	0.5f,
+	TEXT("The time (in milliseconds) that shot cosmetics may take each frame. The local player's cosmetics are exempt. 0 disables the budget."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarCosmeticsMaxDeferFrames(
+	TEXT("fps.Cosmetics.MaxDeferFrames"),
+	2,
+	TEXT("The number of frames that on-screen cosmetics can be deferred for before they are dropped."),
+	ECVF_Default);
+
+void UCosmeticSchedulerSubsystem::ScheduleCosmetics(AWeaponBase* Weapon, const EShotCosmetics Cosmetics,
+                                                    const ECosmeticPriority Priority)
+{
+	if (!Weapon || Cosmetics == EShotCosmetics::None)
+	{
+		return;
+	}
+
+	FScheduledCosmetic& Scheduled = PendingCosmetics.AddDefaulted_GetRef();
+	Scheduled.Weapon = Weapon;
+	Scheduled.Cosmetics = Cosmetics;
+	Scheduled.Priority = Priority;
+}
+
+void UCosmeticSchedulerSubsystem::Drain()
+{
+	NumDeferred = 0;
+	NumDropped = 0;
+
+	if (PendingCosmetics.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CosmeticSchedulerDrain);
+
+	// Keeping the order that cosmetics were queued in within each priority
+	Algo::StableSortBy(PendingCosmetics, &FScheduledCosmetic::Priority);
+
+	const float BudgetMs = CVarCosmeticsBudgetMs.GetValueOnGameThread();
+	const int32 MaxDeferFrames = CVarCosmeticsMaxDeferFrames.GetValueOnGameThread();
+	const double StartTime = FPlatformTime::Seconds();
+
+	int32 NumKept = 0;
+	for (int32 Index = 0; Index < PendingCosmetics.Num(); ++Index)
+	{
+		FScheduledCosmetic& Scheduled = PendingCosmetics[Index];
+		AWeaponBase* Weapon = Scheduled.Weapon.Get();
+		if (!Weapon)
+		{
+			continue;
+		}
+
+		const bool bWithinBudget = BudgetMs <= 0.0f || (FPlatformTime::Seconds() - StartTime) * 1000.0 < BudgetMs;
+		if (bWithinBudget || Scheduled.Priority == ECosmeticPriority::LocalPlayer)
+		{
+			Weapon->PlayShotCosmetics(Scheduled.Cosmetics);
+			INC_DWORD_STAT(STAT_CosmeticsPlayed);
+		}
+		else if (Scheduled.Priority == ECosmeticPriority::OffScreen || Scheduled.FramesDeferred >= MaxDeferFrames)
+		{
+			++NumDropped;
+		}
+		else
+		{
+			// Merging with the cosmetics that the weapon already has deferred at this priority, as one muzzle flash and
+			// sound can stand in for every shot that has missed the budget. The merged cosmetics are only as old as the
+			// newest shot in them
+			FScheduledCosmetic* Deferred = nullptr;
+			for (int32 KeptIndex = 0; KeptIndex < NumKept; ++KeptIndex)
+			{
+				if (PendingCosmetics[KeptIndex].Weapon == Scheduled.Weapon && PendingCosmetics[KeptIndex].Priority == Scheduled.Priority)
+				{
+					Deferred = &PendingCosmetics[KeptIndex];
+					break;
+				}
+			}
+
+			if (Deferred)
+			{
+				Deferred->Cosmetics |= Scheduled.Cosmetics;
+				Deferred->FramesDeferred = Scheduled.FramesDeferred + 1;
+			}
+			else
+			{
+				// Compacting the deferred cosmetics to the front of the queue, ready for the next frame
+				++Scheduled.FramesDeferred;
+				PendingCosmetics[NumKept++] = Scheduled;
+				++NumDeferred;
+			}
+		}
+	}
+
+	PendingCosmetics.SetNum(NumKept, EAllowShrinking::No);
+
+	INC_DWORD_STAT_BY(STAT_CosmeticsDeferred, NumDeferred);
+	INC_DWORD_STAT_BY(STAT_CosmeticsDropped, NumDropped);
+}
+
+void UCosmeticSchedulerSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Drain();
+}
+
+TStatId UCosmeticSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCosmeticSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+bool UCosmeticSchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
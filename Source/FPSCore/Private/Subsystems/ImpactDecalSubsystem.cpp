@@ -0,0 +1,114 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/ImpactDecalSubsystem.h"
+#include "FPSCore.h"
+#include "Components/DecalComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Impact Decals"), STAT_ImpactDecals, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarDecalMaxTotal(
+	TEXT("fps.Decals.MaxTotal"),
+	256,
+	TEXT("The maximum number of bullet hole decals in the world, across every surface."),
+	ECVF_Default);
+
+void UImpactDecalSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	for (int32& Budget : SurfaceBudgetLookup)
+	{
+		Budget = DefaultSurfaceBudget;
+	}
+	for (const FSurfaceDecalBudget& SurfaceBudget : SurfaceBudgets)
+	{
+		SurfaceBudgetLookup[SurfaceBudget.SurfaceType] = SurfaceBudget.MaxDecals;
+	}
+}
+
+void UImpactDecalSubsystem::AddDecal(const FHitResult& Hit, const EPhysicalSurface SurfaceType, UMaterialInterface* Material,
+                                     const FVector& Size)
+{
+	const UPrimitiveComponent* HitComponent = Hit.GetComponent();
+	const int32 SurfaceBudget = SurfaceBudgetLookup[SurfaceType];
+	if (!Material || SurfaceBudget <= 0 || !HitComponent || HitComponent->Mobility == EComponentMobility::Movable)
+	{
+		return;
+	}
+
+	// Projecting the decal into the surface, with a random roll so that neighbouring holes don't all look the same
+	FRotator Rotation = (-Hit.ImpactNormal).Rotation();
+	Rotation.Roll = FMath::FRandRange(-180.0f, 180.0f);
+
+	int32 DecalIndex = INDEX_NONE;
+	if (SurfaceDecals[SurfaceType].Num() >= SurfaceBudget)
+	{
+		// Recycling the oldest decal on this surface
+		DecalIndex = TakeOldestDecal(SurfaceType);
+	}
+	else if (Decals.Num() < CVarDecalMaxTotal.GetValueOnGameThread())
+	{
+		// Growing the pool until either this surface's or the world's budget is reached
+		UDecalComponent* Decal = UGameplayStatics::SpawnDecalAtLocation(this, Material, Size, Hit.ImpactPoint, Rotation, 0.0f);
+		if (!Decal)
+		{
+			return;
+		}
+
+		SurfaceDecals[SurfaceType].Add(Decals.Add(Decal));
+		DecalPlacedOrder.Add(++NumPlaced);
+		SET_DWORD_STAT(STAT_ImpactDecals, Decals.Num());
+		return;
+	}
+	else
+	{
+		// The world's budget is used up while this surface still has room, so the oldest decal in the world moves over
+		// to this surface. Otherwise surfaces hit later in a match would never get a decal
+		int32 OldestSurface = INDEX_NONE;
+		uint64 OldestOrder = MAX_uint64;
+		for (int32 Surface = 0; Surface < SurfaceType_Max; ++Surface)
+		{
+			if (SurfaceDecals[Surface].Num() > 0 && DecalPlacedOrder[SurfaceDecals[Surface][0]] < OldestOrder)
+			{
+				OldestSurface = Surface;
+				OldestOrder = DecalPlacedOrder[SurfaceDecals[Surface][0]];
+			}
+		}
+
+		if (OldestSurface == INDEX_NONE)
+		{
+			return;
+		}
+		DecalIndex = TakeOldestDecal(static_cast<EPhysicalSurface>(OldestSurface));
+	}
+
+	SurfaceDecals[SurfaceType].Add(DecalIndex);
+	DecalPlacedOrder[DecalIndex] = ++NumPlaced;
+
+	UDecalComponent* Decal = Decals[DecalIndex];
+	if (Decal)
+	{
+		Decal->SetDecalMaterial(Material);
+		Decal->DecalSize = Size;
+		Decal->SetWorldLocationAndRotation(Hit.ImpactPoint, Rotation);
+		Decal->MarkRenderStateDirty();
+	}
+}
+
+int32 UImpactDecalSubsystem::TakeOldestDecal(const EPhysicalSurface SurfaceType)
+{
+	// Surface budgets are small, so keeping each surface's decals in age order is cheaper than tracking ring buffers that
+	// decals can move between
+	TArray<int32>& Slots = SurfaceDecals[SurfaceType];
+	const int32 DecalIndex = Slots[0];
+	Slots.RemoveAt(0, 1, EAllowShrinking::No);
+	return DecalIndex;
+}
+
+bool UImpactDecalSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
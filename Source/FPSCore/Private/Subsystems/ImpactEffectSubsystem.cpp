@@ -0,0 +1,167 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/ImpactEffectSubsystem.h"
+#include "FPSCore.h"
+#include "NiagaraDataChannel.h"
+#include "NiagaraDataChannelAccessor.h"
+#include "NiagaraFunctionLibrary.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Impact Effects Flush"), STAT_ImpactEffectsFlush, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impacts Written To Data Channels"), STAT_ImpactsWritten, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Impacts Spawned As Systems"), STAT_ImpactsSpawned, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarImpactMaxPerFrame(
+	TEXT("fps.Impacts.MaxPerFrame"),
+	512,
+	TEXT("The maximum number of impact effects written per frame. Impacts past this limit are dropped."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarImpactCellSize(
+	TEXT("fps.Impacts.CellSize"),
+	5000.0f,
+	TEXT("The size (in cm) of the grid cells that impacts are batched by. Should be no larger than the islands of the impact data channels."),
+	ECVF_Default);
+
+/** The names of the variables that impact data channels are expected to contain */
+static const FName ImpactPositionName(TEXT("Position"));
+static const FName ImpactNormalName(TEXT("Normal"));
+static const FName ImpactSurfaceName(TEXT("SurfaceType"));
+
+void UImpactEffectSubsystem::AddImpact(const FQueuedImpact& Impact)
+{
+	if (!Impact.DataChannel && !Impact.FallbackEffect)
+	{
+		return;
+	}
+
+	// The shot queue and projectiles each flush as they resolve, so the limit is counted across the whole frame rather
+	// than against the impacts waiting for the next flush
+	if (ImpactFrame != GFrameCounter)
+	{
+		ImpactFrame = GFrameCounter;
+		NumImpactsThisFrame = 0;
+	}
+
+	if (NumImpactsThisFrame < CVarImpactMaxPerFrame.GetValueOnGameThread())
+	{
+		++NumImpactsThisFrame;
+		PendingImpacts.Add(Impact);
+
+		const double CellSize = FMath::Max(CVarImpactCellSize.GetValueOnGameThread(), 1.0f);
+		PendingCells.Add(FIntVector(FMath::FloorToInt32(Impact.Location.X / CellSize),
+		                            FMath::FloorToInt32(Impact.Location.Y / CellSize),
+		                            FMath::FloorToInt32(Impact.Location.Z / CellSize)));
+	}
+}
+
+void UImpactEffectSubsystem::Flush()
+{
+	if (PendingImpacts.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ImpactEffectsFlush);
+
+	// Grouping impacts by data channel and then by cell, so that the impacts of a channel that landed near each other
+	// are written with a single writer
+	WriteOrder.Reset();
+	for (int32 Index = 0; Index < PendingImpacts.Num(); ++Index)
+	{
+		WriteOrder.Add(Index);
+	}
+	WriteOrder.Sort([this](const int32 A, const int32 B)
+	{
+		const UNiagaraDataChannelAsset* ChannelA = PendingImpacts[A].DataChannel;
+		const UNiagaraDataChannelAsset* ChannelB = PendingImpacts[B].DataChannel;
+		if (ChannelA != ChannelB)
+		{
+			return ChannelA < ChannelB;
+		}
+		const FIntVector& CellA = PendingCells[A];
+		const FIntVector& CellB = PendingCells[B];
+		return CellA.X != CellB.X ? CellA.X < CellB.X : CellA.Y != CellB.Y ? CellA.Y < CellB.Y : CellA.Z < CellB.Z;
+	});
+
+	int32 GroupStart = 0;
+	while (GroupStart < WriteOrder.Num())
+	{
+		const UNiagaraDataChannelAsset* DataChannel = PendingImpacts[WriteOrder[GroupStart]].DataChannel;
+		const FIntVector Cell = PendingCells[WriteOrder[GroupStart]];
+		int32 GroupEnd = GroupStart + 1;
+		while (GroupEnd < WriteOrder.Num() && PendingImpacts[WriteOrder[GroupEnd]].DataChannel == DataChannel
+			&& PendingCells[WriteOrder[GroupEnd]] == Cell)
+		{
+			++GroupEnd;
+		}
+
+		UNiagaraDataChannelWriter* Writer = nullptr;
+		if (DataChannel)
+		{
+			// Searching for the channel's data at the middle of the group's impacts, which all lie within one cell
+			FBox GroupBounds(ForceInit);
+			for (int32 Index = GroupStart; Index < GroupEnd; ++Index)
+			{
+				GroupBounds += PendingImpacts[WriteOrder[Index]].Location;
+			}
+
+			FNiagaraDataChannelSearchParameters SearchParameters;
+			SearchParameters.Location = GroupBounds.GetCenter();
+			Writer = UNiagaraDataChannelLibrary::WriteToNiagaraDataChannel(this, DataChannel, SearchParameters,
+			                                                              GroupEnd - GroupStart, false, true, true,
+			                                                              TEXT("FPSCore Impacts"));
+		}
+
+		if (Writer)
+		{
+			for (int32 Index = GroupStart; Index < GroupEnd; ++Index)
+			{
+				const FQueuedImpact& Impact = PendingImpacts[WriteOrder[Index]];
+				Writer->WritePosition(ImpactPositionName, Index - GroupStart, Impact.Location);
+				Writer->WriteVector(ImpactNormalName, Index - GroupStart, Impact.Normal);
+				Writer->WriteInt(ImpactSurfaceName, Index - GroupStart, Impact.SurfaceType);
+			}
+			INC_DWORD_STAT_BY(STAT_ImpactsWritten, GroupEnd - GroupStart);
+		}
+		else
+		{
+			// Spawning from the component pool for surfaces without a data channel, or if the channel couldn't be written
+			for (int32 Index = GroupStart; Index < GroupEnd; ++Index)
+			{
+				const FQueuedImpact& Impact = PendingImpacts[WriteOrder[Index]];
+				if (Impact.FallbackEffect)
+				{
+					UNiagaraFunctionLibrary::SpawnSystemAtLocation(this, Impact.FallbackEffect, Impact.Location,
+					                                               Impact.Normal.Rotation(), FVector(1.0f), true, true,
+					                                               ENCPoolMethod::AutoRelease);
+					INC_DWORD_STAT(STAT_ImpactsSpawned);
+				}
+			}
+		}
+
+		GroupStart = GroupEnd;
+	}
+
+	PendingImpacts.Reset();
+	PendingCells.Reset();
+}
+
+void UImpactEffectSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Catching any impacts that weren't flushed by the system that produced them
+	Flush();
+}
+
+TStatId UImpactEffectSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UImpactEffectSubsystem, STATGROUP_Tickables);
+}
+
+bool UImpactEffectSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,270 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/NearMissSubsystem.h"
+#include "FPSCore.h"
+#include "WeaponBase.h"
+#include "Components/HealthComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Math/VectorRegister.h"
+
+DECLARE_CYCLE_STAT(TEXT("Near Miss Process"), STAT_NearMissProcess, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Near Miss Segments"), STAT_NearMissSegments, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Near Misses"), STAT_NearMisses, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarNearMissEnable(
+	TEXT("fps.NearMiss.Enable"),
+	1,
+	TEXT("Whether rounds passing close to players trigger near misses."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarNearMissRadius(
+	TEXT("fps.NearMiss.Radius"),
+	150.0f,
+	TEXT("How close (in cm) a round has to pass to a player to count as a near miss."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarNearMissCellSize(
+	TEXT("fps.NearMiss.CellSize"),
+	5000.0f,
+	TEXT("The size (in cm) of the grid cells that players are bucketed into before segments are tested against them."),
+	ECVF_Default);
+
+void UNearMissSubsystem::AddSegment(const FVector& Start, const FVector& End, AWeaponBase* Weapon,
+                                    const TArrayView<AActor* const> HitActors)
+{
+	FNearMissSegment& Segment = PendingSegments.AddDefaulted_GetRef();
+	Segment.Start = Start;
+	Segment.End = End;
+	Segment.Weapon = Weapon;
+	Segment.Instigator = Weapon ? Weapon->GetOwner() : nullptr;
+	Segment.FirstHitActor = PendingHitActors.Num();
+	Segment.NumHitActors = HitActors.Num();
+	PendingHitActors.Append(HitActors);
+}
+
+void UNearMissSubsystem::Process()
+{
+	if (PendingSegments.Num() == 0)
+	{
+		return;
+	}
+
+	if (!CVarNearMissEnable.GetValueOnGameThread())
+	{
+		PendingSegments.Reset();
+		PendingHitActors.Reset();
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_NearMissProcess);
+	INC_DWORD_STAT_BY(STAT_NearMissSegments, PendingSegments.Num());
+
+	const float Radius = CVarNearMissRadius.GetValueOnGameThread();
+	const double CellSize = FMath::Max(CVarNearMissCellSize.GetValueOnGameThread(), Radius);
+
+	// Bucketing every player into the coarse grid, sorted so that players sharing a cell are next to each other
+	Listeners.Reset();
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		const APlayerController* PlayerController = Iterator->Get();
+		if (APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr)
+		{
+			const FVector Location = Pawn->GetPawnViewLocation();
+			Listeners.Add({Pawn, Location, FIntVector(FMath::FloorToInt32(Location.X / CellSize),
+			                                          FMath::FloorToInt32(Location.Y / CellSize),
+			                                          FMath::FloorToInt32(Location.Z / CellSize))});
+		}
+	}
+	Listeners.Sort([](const FNearMissListener& A, const FNearMissListener& B)
+	{
+		return A.Cell.X != B.Cell.X ? A.Cell.X < B.Cell.X : A.Cell.Y != B.Cell.Y ? A.Cell.Y < B.Cell.Y : A.Cell.Z < B.Cell.Z;
+	});
+
+	// Whether the round of a segment hit the player, in which case it isn't a near miss for them
+	const auto WasHitBy = [this](const FNearMissSegment& Segment, const APawn* Pawn)
+	{
+		for (int32 Index = Segment.FirstHitActor; Index < Segment.FirstHitActor + Segment.NumHitActors; ++Index)
+		{
+			if (PendingHitActors[Index].Get() == Pawn)
+			{
+				return true;
+			}
+		}
+		return false;
+	};
+
+	const VectorRegister4Float Zero = VectorZeroFloat();
+	const VectorRegister4Float One = VectorOneFloat();
+
+	int32 GroupStart = 0;
+	while (GroupStart < Listeners.Num())
+	{
+		const FIntVector Cell = Listeners[GroupStart].Cell;
+		int32 GroupEnd = GroupStart + 1;
+		while (GroupEnd < Listeners.Num() && Listeners[GroupEnd].Cell == Cell)
+		{
+			++GroupEnd;
+		}
+
+		// Gathering the segments that come within the near miss radius of the cell. Positions are stored relative to
+		// the cell's centre, so that they keep their precision as floats
+		const FVector CellMin = FVector(Cell) * CellSize;
+		const FBox CellBounds(CellMin - FVector(Radius), CellMin + FVector(CellSize + Radius));
+		const FVector Origin = CellMin + FVector(CellSize * 0.5);
+
+		StartX.Reset();
+		StartY.Reset();
+		StartZ.Reset();
+		DeltaX.Reset();
+		DeltaY.Reset();
+		DeltaZ.Reset();
+		InvLengthSquared.Reset();
+		SegmentIndices.Reset();
+
+		for (int32 Index = 0; Index < PendingSegments.Num(); ++Index)
+		{
+			const FNearMissSegment& Segment = PendingSegments[Index];
+			if (!CellBounds.Intersect(FBox(Segment.Start.ComponentMin(Segment.End), Segment.Start.ComponentMax(Segment.End))))
+			{
+				continue;
+			}
+
+			const FVector3f Start(Segment.Start - Origin);
+			const FVector3f Delta(Segment.End - Segment.Start);
+			const float LengthSquared = Delta.SizeSquared();
+			StartX.Add(Start.X);
+			StartY.Add(Start.Y);
+			StartZ.Add(Start.Z);
+			DeltaX.Add(Delta.X);
+			DeltaY.Add(Delta.Y);
+			DeltaZ.Add(Delta.Z);
+			InvLengthSquared.Add(LengthSquared > UE_SMALL_NUMBER ? 1.0f / LengthSquared : 0.0f);
+			SegmentIndices.Add(Index);
+		}
+
+		if (SegmentIndices.Num() == 0)
+		{
+			GroupStart = GroupEnd;
+			continue;
+		}
+
+		// Padding to a whole number of blocks with points far outside the cell, which can never be a near miss
+		while (SegmentIndices.Num() % 4 != 0)
+		{
+			StartX.Add(UE_BIG_NUMBER);
+			StartY.Add(UE_BIG_NUMBER);
+			StartZ.Add(UE_BIG_NUMBER);
+			DeltaX.Add(0.0f);
+			DeltaY.Add(0.0f);
+			DeltaZ.Add(0.0f);
+			InvLengthSquared.Add(0.0f);
+			SegmentIndices.Add(INDEX_NONE);
+		}
+
+		for (int32 ListenerIndex = GroupStart; ListenerIndex < GroupEnd; ++ListenerIndex)
+		{
+			const FNearMissListener& Listener = Listeners[ListenerIndex];
+			const FVector3f Point(Listener.Location - Origin);
+			const VectorRegister4Float Px = VectorSetFloat1(Point.X);
+			const VectorRegister4Float Py = VectorSetFloat1(Point.Y);
+			const VectorRegister4Float Pz = VectorSetFloat1(Point.Z);
+
+			float BestDistanceSquared = Radius * Radius;
+			int32 BestSegment = INDEX_NONE;
+
+			// The distance from the player to four segments at a time: the player is projected onto each segment, the
+			// projection is clamped to the segment's ends and the distance to that closest point is measured
+			for (int32 Index = 0; Index < SegmentIndices.Num(); Index += 4)
+			{
+				const VectorRegister4Float Sx = VectorLoad(StartX.GetData() + Index);
+				const VectorRegister4Float Sy = VectorLoad(StartY.GetData() + Index);
+				const VectorRegister4Float Sz = VectorLoad(StartZ.GetData() + Index);
+				const VectorRegister4Float Dx = VectorLoad(DeltaX.GetData() + Index);
+				const VectorRegister4Float Dy = VectorLoad(DeltaY.GetData() + Index);
+				const VectorRegister4Float Dz = VectorLoad(DeltaZ.GetData() + Index);
+
+				const VectorRegister4Float Rx = VectorSubtract(Px, Sx);
+				const VectorRegister4Float Ry = VectorSubtract(Py, Sy);
+				const VectorRegister4Float Rz = VectorSubtract(Pz, Sz);
+
+				VectorRegister4Float T = VectorMultiply(VectorMultiplyAdd(Rx, Dx, VectorMultiplyAdd(Ry, Dy, VectorMultiply(Rz, Dz))),
+				                                        VectorLoad(InvLengthSquared.GetData() + Index));
+				T = VectorMin(VectorMax(T, Zero), One);
+
+				const VectorRegister4Float Cx = VectorNegateMultiplyAdd(T, Dx, Rx);
+				const VectorRegister4Float Cy = VectorNegateMultiplyAdd(T, Dy, Ry);
+				const VectorRegister4Float Cz = VectorNegateMultiplyAdd(T, Dz, Rz);
+
+				float DistanceSquared[4];
+				VectorStore(VectorMultiplyAdd(Cx, Cx, VectorMultiplyAdd(Cy, Cy, VectorMultiply(Cz, Cz))), DistanceSquared);
+
+				for (int32 Lane = 0; Lane < 4; ++Lane)
+				{
+					const int32 SegmentIndex = SegmentIndices[Index + Lane];
+					// Players are never suppressed by their own rounds, nor by a round that hit them
+					if (DistanceSquared[Lane] < BestDistanceSquared && SegmentIndex != INDEX_NONE
+						&& PendingSegments[SegmentIndex].Instigator.Get() != Listener.Pawn
+						&& !WasHitBy(PendingSegments[SegmentIndex], Listener.Pawn))
+					{
+						BestDistanceSquared = DistanceSquared[Lane];
+						BestSegment = SegmentIndex;
+					}
+				}
+			}
+
+			if (BestSegment == INDEX_NONE)
+			{
+				continue;
+			}
+
+			const FNearMissSegment& Segment = PendingSegments[BestSegment];
+
+			FNearMissEvent NearMiss;
+			NearMiss.Listener = Listener.Pawn;
+			NearMiss.Instigator = Segment.Instigator.Get();
+			NearMiss.ClosestPoint = FMath::ClosestPointOnSegment(Listener.Location, Segment.Start, Segment.End);
+			NearMiss.Distance = FMath::Sqrt(BestDistanceSquared);
+			NearMiss.Suppression = 1.0f - NearMiss.Distance / Radius;
+			INC_DWORD_STAT(STAT_NearMisses);
+
+			// Only the player hearing the round gets its whizz
+			AWeaponBase* Weapon = Segment.Weapon.Get();
+			if (Weapon && Weapon->GetStaticWeaponData()->NearMissSound && Listener.Pawn->IsLocallyControlled())
+			{
+				UGameplayStatics::PlaySoundAtLocation(this, Weapon->GetStaticWeaponData()->NearMissSound, NearMiss.ClosestPoint);
+			}
+
+			if (UHealthComponent* HealthComponent = Listener.Pawn->FindComponentByClass<UHealthComponent>())
+			{
+				HealthComponent->OnSuppressed.Broadcast(HealthComponent, NearMiss.Suppression, NearMiss.ClosestPoint, NearMiss.Instigator);
+			}
+			OnNearMiss.Broadcast(NearMiss);
+		}
+
+		GroupStart = GroupEnd;
+	}
+
+	PendingSegments.Reset();
+	PendingHitActors.Reset();
+}
+
+void UNearMissSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	Process();
+}
+
+TStatId UNearMissSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UNearMissSubsystem, STATGROUP_Tickables);
+}
+
+bool UNearMissSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
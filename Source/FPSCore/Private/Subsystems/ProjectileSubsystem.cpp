@@ -0,0 +1,257 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/ProjectileSubsystem.h"
+#include "Subsystems/ImpactEffectSubsystem.h"
+#include "Subsystems/NearMissSubsystem.h"
+#include "FPSCore.h"
+#include "WeaponBase.h"
+#include "Async/ParallelFor.h"
+#include "CollisionQueryParams.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/VectorRegister.h"
+#include "Physics/PhysicsInterfaceCore.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile Integrate"), STAT_ProjectileIntegrate, STATGROUP_FPSCore);
+DECLARE_CYCLE_STAT(TEXT("Projectile Traces"), STAT_ProjectileTraces, STATGROUP_FPSCore);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Live Projectiles"), STAT_LiveProjectiles, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarMaxProjectiles(
+	TEXT("fps.Projectiles.Max"),
+	4096,
+	TEXT("The maximum number of projectiles in flight per world. New projectiles are discarded past this limit."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarProjectileMinBatchSize(
+	TEXT("fps.Projectiles.MinBatchSize"),
+	16,
+	TEXT("The minimum number of projectile segment traces handed to each worker thread."),
+	ECVF_Default);
+
+void UProjectileSubsystem::LaunchProjectile(const FProjectileLaunchParams& Params)
+{
+	if (!Params.Weapon.IsValid() || PositionX.Num() >= CVarMaxProjectiles.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	Origin.Add(Params.Origin);
+	PositionX.Add(0.0f);
+	PositionY.Add(0.0f);
+	PositionZ.Add(0.0f);
+	VelocityX.Add(Params.Velocity.X);
+	VelocityY.Add(Params.Velocity.Y);
+	VelocityZ.Add(Params.Velocity.Z);
+	Drag.Add(Params.DragCoefficient);
+	Gravity.Add(Params.GravityZ);
+	Lifetime.Add(Params.Lifetime);
+	TraceChannel.Add(Params.TraceChannel);
+	TraceComplex.Add(Params.bTraceComplex);
+	OwnerWeapon.Add(Params.Weapon);
+	CosmeticLOD.Add(Params.CosmeticLOD);
+}
+
+void UProjectileSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SET_DWORD_STAT(STAT_LiveProjectiles, PositionX.Num());
+
+	if (PositionX.Num() == 0 || DeltaTime <= 0.0f)
+	{
+		return;
+	}
+
+	Integrate(DeltaTime);
+	TraceSegments();
+	ResolveSegments();
+}
+
+void UProjectileSubsystem::Integrate(const float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileIntegrate);
+
+	const int32 Num = PositionX.Num();
+
+	// Storing the start of each segment before we move anything
+	SegmentStart.SetNumUninitialized(Num, EAllowShrinking::No);
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		SegmentStart[Index] = Origin[Index] + FVector(PositionX[Index], PositionY[Index], PositionZ[Index]);
+	}
+
+	float* RESTRICT PX = PositionX.GetData();
+	float* RESTRICT PY = PositionY.GetData();
+	float* RESTRICT PZ = PositionZ.GetData();
+	float* RESTRICT VX = VelocityX.GetData();
+	float* RESTRICT VY = VelocityY.GetData();
+	float* RESTRICT VZ = VelocityZ.GetData();
+	float* RESTRICT Life = Lifetime.GetData();
+	const float* RESTRICT K = Drag.GetData();
+	const float* RESTRICT G = Gravity.GetData();
+
+	// Semi-implicit Euler with quadratic drag: v /= 1 + k|v|dt, v += g * dt, p += v * dt. Dividing by the drag factor
+	// (the implicit form of v -= k|v|v * dt) can only ever slow a projectile down, however large the drag or the frame
+	// time, where subtracting would overshoot and reverse it. Four projectiles are advanced at a time, with the
+	// remainder handled by the scalar loop below
+	const VectorRegister4Float Dt = VectorSetFloat1(DeltaTime);
+	const VectorRegister4Float One = GlobalVectorConstants::FloatOne;
+	const int32 NumVectorised = Num & ~3;
+	for (int32 Index = 0; Index < NumVectorised; Index += 4)
+	{
+		VectorRegister4Float Vx = VectorLoad(VX + Index);
+		VectorRegister4Float Vy = VectorLoad(VY + Index);
+		VectorRegister4Float Vz = VectorLoad(VZ + Index);
+
+		const VectorRegister4Float SpeedSquared = VectorMultiplyAdd(Vx, Vx, VectorMultiplyAdd(Vy, Vy, VectorMultiply(Vz, Vz)));
+		const VectorRegister4Float DragDt = VectorMultiply(VectorMultiply(VectorLoad(K + Index), VectorSqrt(SpeedSquared)), Dt);
+		const VectorRegister4Float DragScale = VectorDivide(One, VectorAdd(One, DragDt));
+
+		Vx = VectorMultiply(Vx, DragScale);
+		Vy = VectorMultiply(Vy, DragScale);
+		Vz = VectorMultiplyAdd(VectorLoad(G + Index), Dt, VectorMultiply(Vz, DragScale));
+
+		VectorStore(Vx, VX + Index);
+		VectorStore(Vy, VY + Index);
+		VectorStore(Vz, VZ + Index);
+
+		VectorStore(VectorMultiplyAdd(Vx, Dt, VectorLoad(PX + Index)), PX + Index);
+		VectorStore(VectorMultiplyAdd(Vy, Dt, VectorLoad(PY + Index)), PY + Index);
+		VectorStore(VectorMultiplyAdd(Vz, Dt, VectorLoad(PZ + Index)), PZ + Index);
+
+		VectorStore(VectorSubtract(VectorLoad(Life + Index), Dt), Life + Index);
+	}
+
+	for (int32 Index = NumVectorised; Index < Num; ++Index)
+	{
+		const float DragDt = K[Index] * FMath::Sqrt(VX[Index] * VX[Index] + VY[Index] * VY[Index] + VZ[Index] * VZ[Index]) * DeltaTime;
+		const float DragScale = 1.0f / (1.0f + DragDt);
+
+		VX[Index] *= DragScale;
+		VY[Index] *= DragScale;
+		VZ[Index] = VZ[Index] * DragScale + G[Index] * DeltaTime;
+
+		PX[Index] += VX[Index] * DeltaTime;
+		PY[Index] += VY[Index] * DeltaTime;
+		PZ[Index] += VZ[Index] * DeltaTime;
+
+		Life[Index] -= DeltaTime;
+	}
+}
+
+void UProjectileSubsystem::TraceSegments()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ProjectileTraces);
+
+	UWorld* World = GetWorld();
+	const int32 Num = PositionX.Num();
+
+	SegmentHit.SetNum(Num, EAllowShrinking::No);
+	SegmentBlocked.SetNumUninitialized(Num, EAllowShrinking::No);
+	SegmentQueryIndex.SetNumUninitialized(Num, EAllowShrinking::No);
+
+	// Building the query parameters on the game thread, as resolving the owning weapons is not safe on worker threads.
+	// Every projectile from the same weapon shares one set, so they are only built once per weapon
+	OwnerQueryParams.Reset();
+	OwnerQueryLookup.Reset();
+	for (int32 Index = 0; Index < Num; ++Index)
+	{
+		const AWeaponBase* Weapon = OwnerWeapon[Index].Get();
+		const TPair<const AWeaponBase*, bool> Key(Weapon, TraceComplex[Index]);
+		if (const int32* QueryIndex = OwnerQueryLookup.Find(Key))
+		{
+			SegmentQueryIndex[Index] = *QueryIndex;
+			continue;
+		}
+
+		FCollisionQueryParams& QueryParams = OwnerQueryParams.Emplace_GetRef(SCENE_QUERY_STAT(FPSCoreProjectile), TraceComplex[Index]);
+		QueryParams.bReturnPhysicalMaterial = true;
+		if (Weapon)
+		{
+			QueryParams.AddIgnoredActor(Weapon);
+			QueryParams.AddIgnoredActor(Weapon->GetOwner());
+		}
+		SegmentQueryIndex[Index] = OwnerQueryLookup.Add(Key, OwnerQueryParams.Num() - 1);
+	}
+
+	// Tracing only the distance each projectile covered this frame, under a single scene read lock
+	FPhysicsCommand::ExecuteRead(World->GetPhysicsScene(), [&]()
+	{
+		ParallelFor(TEXT("FPSCore.Projectiles"), Num, FMath::Max(1, CVarProjectileMinBatchSize.GetValueOnGameThread()),
+		            [&](const int32 Index)
+		{
+			const FVector SegmentEnd = Origin[Index] + FVector(PositionX[Index], PositionY[Index], PositionZ[Index]);
+			SegmentBlocked[Index] = World->LineTraceSingleByChannel(SegmentHit[Index], SegmentStart[Index], SegmentEnd,
+			                                                        TraceChannel[Index],
+			                                                        OwnerQueryParams[SegmentQueryIndex[Index]]);
+		});
+	});
+}
+
+void UProjectileSubsystem::ResolveSegments()
+{
+	UNearMissSubsystem* NearMisses = GetWorld()->GetSubsystem<UNearMissSubsystem>();
+
+	// Walking backwards so that removing a projectile never skips one
+	for (int32 Index = PositionX.Num() - 1; Index >= 0; --Index)
+	{
+		// Handing the segment that the projectile travelled this frame to near miss detection
+		if (NearMisses)
+		{
+			const FVector SegmentEnd = SegmentBlocked[Index]
+				                           ? SegmentHit[Index].Location
+				                           : Origin[Index] + FVector(PositionX[Index], PositionY[Index], PositionZ[Index]);
+			AActor* const HitActor = SegmentHit[Index].GetActor();
+			NearMisses->AddSegment(SegmentStart[Index], SegmentEnd, OwnerWeapon[Index].Get(),
+			                       SegmentBlocked[Index] && HitActor ? MakeArrayView(&HitActor, 1) : TArrayView<AActor* const>());
+		}
+
+		if (SegmentBlocked[Index])
+		{
+			if (AWeaponBase* Weapon = OwnerWeapon[Index].Get())
+			{
+				const FVector Direction = FVector(VelocityX[Index], VelocityY[Index], VelocityZ[Index]).GetSafeNormal();
+				Weapon->ApplyImpact(SegmentHit[Index], Direction, CosmeticLOD[Index]);
+			}
+			RemoveProjectile(Index);
+		}
+		else if (Lifetime[Index] <= 0.0f || !OwnerWeapon[Index].IsValid())
+		{
+			RemoveProjectile(Index);
+		}
+	}
+
+	// Writing out the impact effects of every projectile that landed this frame
+	if (UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>())
+	{
+		ImpactEffects->Flush();
+	}
+}
+
+void UProjectileSubsystem::RemoveProjectile(const int32 Index)
+{
+	Origin.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PositionX.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PositionY.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	PositionZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityX.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityY.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	VelocityZ.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Drag.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Gravity.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	Lifetime.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	TraceChannel.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	TraceComplex.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	OwnerWeapon.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+	CosmeticLOD.RemoveAtSwap(Index, 1, EAllowShrinking::No);
+}
+
+TStatId UProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UProjectileSubsystem, STATGROUP_Tickables);
+}
+
+bool UProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,143 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/ShotDebugSubsystem.h"
+#include "FPSCore.h"
+#include "WeaponBase.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shot Debug Draw"), STAT_ShotDebugDraw, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarShotDebugEnable(
+	TEXT("fps.ShotDebug.Enable"),
+	0,
+	TEXT("1: Record the debug lines of every weapon's shots. 0: Only record shots from weapons with bShowDebug set."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarShotDebugMaxShots(
+	TEXT("fps.ShotDebug.MaxShots"),
+	32,
+	TEXT("The number of shots kept by the shot debug recorder. The oldest shot is overwritten once it is full."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarShotDebugDuration(
+	TEXT("fps.ShotDebug.Duration"),
+	10.0f,
+	TEXT("How long (in seconds) each recorded shot is drawn for."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<FString> CVarShotDebugWeaponFilter(
+	TEXT("fps.ShotDebug.WeaponFilter"),
+	TEXT(""),
+	TEXT("Only draw shots from weapons whose name contains this string. Empty draws every weapon."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<FString> CVarShotDebugOwnerFilter(
+	TEXT("fps.ShotDebug.OwnerFilter"),
+	TEXT(""),
+	TEXT("Only draw shots from weapons whose owner's name contains this string. Empty draws every owner."),
+	ECVF_Default);
+
+bool UShotDebugSubsystem::IsRecordingAllShots()
+{
+	return CVarShotDebugEnable.GetValueOnGameThread() != 0;
+}
+
+void UShotDebugSubsystem::BeginShot(const AWeaponBase* Weapon)
+{
+	const int32 MaxShots = FMath::Max(CVarShotDebugMaxShots.GetValueOnGameThread(), 1);
+	if (Shots.Num() != MaxShots)
+	{
+		Shots.SetNum(MaxShots);
+		NextShot = 0;
+	}
+
+	CurrentShot = &Shots[NextShot];
+	NextShot = (NextShot + 1) % MaxShots;
+
+	CurrentShot->Weapon = Weapon;
+	CurrentShot->Owner = Weapon ? Weapon->GetOwner() : nullptr;
+	CurrentShot->Time = GetWorld()->GetTimeSeconds();
+	CurrentShot->Lines.Reset();
+}
+
+void UShotDebugSubsystem::AddLine(const FVector& Start, const FVector& End, const FColor& Color)
+{
+	if (CurrentShot)
+	{
+		CurrentShot->Lines.Add({Start, End, Color});
+	}
+}
+
+void UShotDebugSubsystem::Clear()
+{
+	Shots.Reset();
+	NextShot = 0;
+	CurrentShot = nullptr;
+}
+
+bool UShotDebugSubsystem::PassesFilters(const FRecordedShot& Shot, const FString& WeaponFilter, const FString& OwnerFilter)
+{
+	if (!WeaponFilter.IsEmpty() && (!Shot.Weapon.IsValid() || !Shot.Weapon->GetName().Contains(WeaponFilter)))
+	{
+		return false;
+	}
+
+	if (!OwnerFilter.IsEmpty() && (!Shot.Owner.IsValid() || !Shot.Owner->GetName().Contains(OwnerFilter)))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void UShotDebugSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Lines can only be added straight after BeginShot, within the same frame
+	CurrentShot = nullptr;
+
+	ULineBatchComponent* LineBatcher = GetWorld()->LineBatcher;
+	if (Shots.Num() == 0 || !LineBatcher)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShotDebugDraw);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	const double Duration = CVarShotDebugDuration.GetValueOnGameThread();
+	const FString WeaponFilter = CVarShotDebugWeaponFilter.GetValueOnGameThread();
+	const FString OwnerFilter = CVarShotDebugOwnerFilter.GetValueOnGameThread();
+
+	BatchedLines.Reset();
+	for (const FRecordedShot& Shot : Shots)
+	{
+		if (Shot.Lines.Num() == 0 || Now - Shot.Time > Duration || !PassesFilters(Shot, WeaponFilter, OwnerFilter))
+		{
+			continue;
+		}
+
+		for (const FShotDebugLine& Line : Shot.Lines)
+		{
+			BatchedLines.Emplace(Line.Start, Line.End, FLinearColor(Line.Color), 0.0f, 2.0f, SDPG_World);
+		}
+	}
+
+	// The world's line batcher is cleared every frame, so the recorded shots are drawn again for as long as they last
+	if (BatchedLines.Num() > 0)
+	{
+		LineBatcher->DrawLines(BatchedLines);
+	}
+}
+
+TStatId UShotDebugSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShotDebugSubsystem, STATGROUP_Tickables);
+}
+
+bool UShotDebugSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
@@ -0,0 +1,257 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Subsystems/ShotQueueSubsystem.h"
+#include "Subsystems/ImpactEffectSubsystem.h"
+#include "FPSCore.h"
+#include "WeaponBase.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Physics/PhysicsInterfaceCore.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shot Queue Flush"), STAT_ShotQueueFlush, STATGROUP_FPSCore);
+DECLARE_CYCLE_STAT(TEXT("Shot Queue Traces"), STAT_ShotQueueTraces, STATGROUP_FPSCore);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Shot Queue Pellets"), STAT_ShotQueuePellets, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarShotQueueEnable(
+	TEXT("fps.ShotQueue.Enable"),
+	1,
+	TEXT("1: Batch hitscan shots and resolve them once per frame. 0: Resolve every shot as soon as it is submitted."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarShotQueueParallel(
+	TEXT("fps.ShotQueue.Parallel"),
+	1,
+	TEXT("Whether to spread the shot queue's traces across worker threads."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarShotQueueMinBatchSize(
+	TEXT("fps.ShotQueue.MinBatchSize"),
+	8,
+	TEXT("The minimum number of pellet traces handed to each worker thread."),
+	ECVF_Default);
+
+/** Traces a single pellet, following it through penetrable surfaces and off ricochets. This runs on worker threads, so
+ *	it only ever writes to the pellet's own result and to its task's scratch buffer, and reads the shot's data */
+static void TracePellet(const UWorld* World, const FShotRequest& Shot, FPelletResult& Pellet, TArray<FHitResult>& Hits)
+{
+	const TArray<FSurfaceData>* Surfaces = Shot.Surfaces.Get();
+
+	// Rounds that can neither penetrate nor ricochet only ever need the first blocking hit
+	if (!Surfaces || (Shot.PenetrationPower <= 0.0f && Shot.MaxRicochets <= 0))
+	{
+		FPelletImpact Impact;
+		Pellet.bBlockingHit = World->LineTraceSingleByChannel(Impact.Hit, Pellet.Start, Pellet.End, Shot.TraceChannel,
+		                                                      Shot.QueryParams);
+		if (Pellet.bBlockingHit)
+		{
+			Pellet.End = Impact.Hit.Location;
+			Impact.Direction = Pellet.Direction;
+			Pellet.Impacts.Add(MoveTemp(Impact));
+		}
+		return;
+	}
+
+	// Gathering every surface along a segment with a single multi-trace. Downgrading the query's response to overlap
+	// turns blocking hits into touches, so the trace carries on past them instead of stopping at the first one
+	FCollisionResponseParams ResponseParams;
+	ResponseParams.CollisionResponse.SetAllChannels(ECR_Overlap);
+
+	float PenetrationPower = Shot.PenetrationPower;
+	int32 RicochetsLeft = Shot.MaxRicochets;
+	float DamageScale = 1.0f;
+	float RangeLeft = Shot.Range;
+	FVector SegmentStart = Pellet.Start;
+	FVector Direction = Pellet.Direction;
+
+	for (int32 Segment = 0; RangeLeft > 0.0f; ++Segment)
+	{
+		FVector SegmentEnd = SegmentStart + Direction * RangeLeft;
+		bool bRicocheted = false;
+		World->LineTraceMultiByChannel(Hits, SegmentStart, SegmentEnd, Shot.TraceChannel, Shot.QueryParams, ResponseParams);
+
+		const UPrimitiveComponent* LastComponent = nullptr;
+		for (const FHitResult& Hit : Hits)
+		{
+			// Skipping anything that wouldn't have stopped a single trace, and further bodies of the component that the
+			// pellet has just entered
+			const UPrimitiveComponent* HitComponent = Hit.GetComponent();
+			if (!HitComponent || HitComponent == LastComponent
+				|| HitComponent->GetCollisionResponseToChannel(Shot.TraceChannel) != ECR_Block)
+			{
+				continue;
+			}
+			LastComponent = HitComponent;
+
+			FPelletImpact& Impact = Pellet.Impacts.AddDefaulted_GetRef();
+			Impact.Hit = Hit;
+			Impact.Direction = Direction;
+			Impact.DamageScale = DamageScale;
+			Pellet.bBlockingHit = true;
+
+			const FSurfaceData& Surface = (*Surfaces)[UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get())];
+
+			// Glancing off the surface if the pellet meets it at a shallow enough angle
+			const float ImpactAngle = FMath::RadiansToDegrees(FMath::Asin(FMath::Min(FMath::Abs(Direction | Hit.ImpactNormal), 1.0f)));
+			if (RicochetsLeft > 0 && Surface.bCanRicochet && ImpactAngle <= Surface.RicochetMaxAngle)
+			{
+				--RicochetsLeft;
+				DamageScale *= Surface.RicochetDamageMultiplier;
+				RangeLeft -= Hit.Distance;
+				SegmentEnd = Hit.Location;
+				SegmentStart = Hit.Location + Hit.ImpactNormal * 0.1f;
+				Direction = Direction.MirrorByVector(Hit.ImpactNormal);
+				bRicocheted = true;
+				break;
+			}
+
+			// Passing through the surface if the pellet has enough penetration power left
+			if (Surface.bPenetrable && PenetrationPower >= Surface.Thickness)
+			{
+				PenetrationPower -= Surface.Thickness;
+				DamageScale *= Surface.PenetrationDamageMultiplier;
+				continue;
+			}
+
+			SegmentEnd = Hit.Location;
+			break;
+		}
+
+		if (Segment == 0)
+		{
+			Pellet.End = SegmentEnd;
+		}
+		else
+		{
+			Pellet.RicochetEnds.Add(SegmentEnd);
+		}
+
+		if (!bRicocheted)
+		{
+			break;
+		}
+	}
+}
+
+void UShotQueueSubsystem::SubmitShot(FShotRequest&& Request)
+{
+	if (Request.Directions.Num() == 0 || !Request.Weapon.IsValid())
+	{
+		return;
+	}
+
+	PendingShots.Add(MoveTemp(Request));
+
+	// Resolving straight away if batching has been disabled
+	if (CVarShotQueueEnable.GetValueOnGameThread() == 0)
+	{
+		Flush();
+	}
+}
+
+void UShotQueueSubsystem::Flush()
+{
+	if (PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_ShotQueueFlush);
+
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		PendingShots.Reset();
+		return;
+	}
+
+	// Swapping the queues so that any shot submitted while we hand results back is kept for the next flush
+	Swap(PendingShots, ResolvingShots);
+
+	// Flattening every pellet of every shot into a single list of traces
+	PelletResults.Reset();
+	for (int32 ShotIndex = 0; ShotIndex < ResolvingShots.Num(); ++ShotIndex)
+	{
+		const FShotRequest& Shot = ResolvingShots[ShotIndex];
+		for (const FVector& Direction : Shot.Directions)
+		{
+			FPelletResult& Pellet = PelletResults.AddDefaulted_GetRef();
+			Pellet.Start = Shot.Origin;
+			Pellet.Direction = Direction;
+			Pellet.End = Shot.Origin + Direction * Shot.Range;
+			Pellet.ShotIndex = ShotIndex;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_ShotQueuePellets, PelletResults.Num());
+
+	// Resolving every trace in one batch. The scene read lock is taken once for the whole batch, and the traces
+	// themselves (including any penetration or ricochet segments) are spread across worker threads - each pellet only
+	// ever writes to its own result
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShotQueueTraces);
+
+		const EParallelForFlags ParallelForFlags = CVarShotQueueParallel.GetValueOnGameThread() != 0
+			                                           ? EParallelForFlags::None
+			                                           : EParallelForFlags::ForceSingleThread;
+		const int32 MinBatchSize = FMath::Max(1, CVarShotQueueMinBatchSize.GetValueOnGameThread());
+
+		// Each task gets its own multi-trace hit buffer, kept between flushes so that steady-state firing never allocates
+		if (TraceScratch.Num() == 0)
+		{
+			TraceScratch.SetNum(FTaskGraphInterface::Get().GetNumWorkerThreads() + 1);
+		}
+
+		FPhysicsCommand::ExecuteRead(World->GetPhysicsScene(), [&]()
+		{
+			ParallelForWithExistingTaskContext(TEXT("FPSCore.ShotQueue"), MakeArrayView(TraceScratch), PelletResults.Num(),
+			                                   MinBatchSize, [&](TArray<FHitResult>& Hits, const int32 PelletIndex)
+			{
+				FPelletResult& Pellet = PelletResults[PelletIndex];
+				TracePellet(World, ResolvingShots[Pellet.ShotIndex], Pellet, Hits);
+			}, ParallelForFlags);
+		});
+	}
+
+	// Handing the results back to each weapon's damage and cosmetics stage, still on the game thread
+	int32 FirstPellet = 0;
+	for (const FShotRequest& Shot : ResolvingShots)
+	{
+		const int32 NumPellets = Shot.Directions.Num();
+		if (AWeaponBase* Weapon = Shot.Weapon.Get())
+		{
+			Weapon->ResolveShot(TArrayView<const FPelletResult>(PelletResults.GetData() + FirstPellet, NumPellets),
+			                    Shot.CosmeticLOD);
+		}
+		FirstPellet += NumPellets;
+	}
+
+	ResolvingShots.Reset();
+
+	// Writing out the impact effects of the batch straight away, rather than waiting for the impact manager's own tick
+	if (UImpactEffectSubsystem* ImpactEffects = World->GetSubsystem<UImpactEffectSubsystem>())
+	{
+		ImpactEffects->Flush();
+	}
+}
+
+void UShotQueueSubsystem::Tick(const float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Tickable objects run after the timer manager and before the camera update, so every shot fired this frame is
+	// resolved (and its cosmetics spawned) before the frame is rendered
+	Flush();
+}
+
+TStatId UShotQueueSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShotQueueSubsystem, STATGROUP_Tickables);
+}
+
+bool UShotQueueSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
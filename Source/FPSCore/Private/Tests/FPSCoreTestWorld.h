@@ -0,0 +1,81 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FPSCharacter.h"
+#include "FPSCharacterController.h"
+#include "Camera/CameraComponent.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/Engine.h"
+#include "Engine/LocalPlayer.h"
+#include "Engine/World.h"
+
+/** A game world that lives for the length of a test, so that actors and world subsystems behave as they do in play.
+ *	Tests tick the whole world a frame at a time */
+class FFPSCoreTestWorld
+{
+public:
+
+	FFPSCoreTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("FPSCoreTestWorld"));
+		FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+
+	~FFPSCoreTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+
+	/** Returns the test world */
+	UWorld* Get() const { return World; }
+
+	/** Spawns a first person character at the origin, looking down the X axis, possessed by an FPS controller of a
+	 *	local player. The character has no movement data set up, which it reports as an error when it begins play and
+	 *	every time it ticks
+	 *	@return The controller of the character, or nullptr if either failed to spawn
+	 */
+	AFPSCharacterController* SpawnPlayer() const
+	{
+		AFPSCharacterController* Controller = World->SpawnActor<AFPSCharacterController>();
+		AFPSCharacter* Character = World->SpawnActor<AFPSCharacter>();
+		if (!Controller || !Character || !Controller->PlayerCameraManager)
+		{
+			return nullptr;
+		}
+
+		// Controllers only turn the view in their tick when they belong to a player, and only update the camera of a
+		// local one
+		Controller->SetPlayer(NewObject<ULocalPlayer>(GEngine, GEngine->LocalPlayerClass));
+
+		// The usual first person camera, which follows the control rotation
+		Character->GetCameraComponent()->bUsePawnControlRotation = true;
+		Controller->Possess(Character);
+		Controller->SetControlRotation(FRotator::ZeroRotator);
+		return Controller;
+	}
+
+	/** Starts a new frame and ticks the whole world through it
+	 *	@param DeltaTime The length of the frame
+	 */
+	void Tick(const float DeltaTime) const
+	{
+		++GFrameCounter;
+		World->Tick(LEVELTICK_All, DeltaTime);
+	}
+
+private:
+
+	UWorld* World;
+};
+
+#endif
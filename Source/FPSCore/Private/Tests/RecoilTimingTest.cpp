@@ -0,0 +1,111 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FPSCoreTestWorld.h"
+#include "WeaponBase.h"
+#include "Curves/CurveFloat.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRecoilTimingTest, "FPSCore.Weapon.RecoilReachesCameraInSameFrame",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::EngineFilter)
+
+bool FRecoilTimingTest::RunTest(const FString& Parameters)
+{
+	const FFPSCoreTestWorld TestWorld;
+	UWorld* World = TestWorld.Get();
+
+	// A player whose camera follows the control rotation. The character reports its missing movement data every frame
+	AddExpectedError(TEXT("Set up data in MovementDataMap"), EAutomationExpectedErrorFlags::Contains, 0);
+	AFPSCharacterController* Controller = TestWorld.SpawnPlayer();
+	if (!TestNotNull(TEXT("Player"), Controller))
+	{
+		return false;
+	}
+	AFPSCharacter* Character = CastChecked<AFPSCharacter>(Controller->GetPawn());
+	APlayerCameraManager* CameraManager = Controller->PlayerCameraManager;
+
+	// An automatic weapon firing every 0.1 s, whose every shot kicks by one unit of pitch input and half a unit of yaw
+	UCurveFloat* VerticalCurve = NewObject<UCurveFloat>();
+	VerticalCurve->FloatCurve.AddKey(0.0f, 1.0f);
+	VerticalCurve->FloatCurve.AddKey(1.0f, 1.0f);
+	UCurveFloat* HorizontalCurve = NewObject<UCurveFloat>();
+	HorizontalCurve->FloatCurve.AddKey(0.0f, 0.5f);
+	HorizontalCurve->FloatCurve.AddKey(1.0f, 0.5f);
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Character;
+	AWeaponBase* Weapon = World->SpawnActor<AWeaponBase>(AWeaponBase::StaticClass(), FTransform::Identity, SpawnParameters);
+	if (!TestNotNull(TEXT("Weapon"), Weapon))
+	{
+		return false;
+	}
+
+	FStaticWeaponData WeaponData = *Weapon->GetStaticWeaponData();
+	WeaponData.bAutomaticFire = true;
+	WeaponData.RateOfFire = 600.0f;
+	WeaponData.VerticalRecoilCurve = VerticalCurve;
+	WeaponData.HorizontalRecoilCurve = HorizontalCurve;
+	Weapon->SetStaticWeaponData(WeaponData);
+
+	FRuntimeWeaponData RuntimeData = *Weapon->GetRuntimeWeaponData();
+	RuntimeData.ClipCapacity = 30;
+	RuntimeData.ClipSize = 30;
+	Weapon->SetRuntimeWeaponData(RuntimeData);
+
+	// Baking the recoil table and equipping the weapon, which hands its fire clock to the controller
+	Weapon->SpawnAttachments();
+	Weapon->OnEquipped();
+
+	// Working out what one kick turns the view by, once the controller's input scales have been applied to it
+	const FRotator InputBefore = Controller->RotationInput;
+	Controller->AddPitchInput(1.0f);
+	Controller->AddYawInput(0.5f);
+	const FRotator KickPerShot = Controller->RotationInput - InputBefore;
+	Controller->RotationInput = InputBefore;
+
+	// A 0.25 s frame of the whole world. The trigger is pulled once the frame has started and before anything ticks,
+	// like input that arrived during the frame, and fires the first shot straight away. The controller then fires the
+	// two shots that fall due later in the frame and turns the view, and the camera is updated once everything ticked
+	bool bTriggerPulled = false;
+	const FDelegateHandle PullTrigger = FWorldDelegates::OnWorldPreActorTick.AddLambda(
+		[World, Weapon, &bTriggerPulled](const UWorld* TickingWorld, ELevelTick, float)
+		{
+			if (TickingWorld == World && !bTriggerPulled)
+			{
+				bTriggerPulled = true;
+				Weapon->StartFire();
+			}
+		});
+
+	constexpr float DeltaTime = 0.25f;
+	TestWorld.Tick(DeltaTime);
+	FWorldDelegates::OnWorldPreActorTick.Remove(PullTrigger);
+
+	const int32 ShotsFired = RuntimeData.ClipSize - Weapon->GetRuntimeWeaponData()->ClipSize;
+	TestEqual(TEXT("Shots fired during the frame"), ShotsFired, 3);
+
+	// The point of view that the camera rendered this frame with
+	const FRotator ExpectedView = KickPerShot * static_cast<float>(ShotsFired);
+	const FRotator CameraView = CameraManager->GetCameraCacheView().Rotation;
+	TestTrue(FString::Printf(TEXT("The camera includes the recoil of every shot fired this frame (expected %s, got %s)"),
+	                         *ExpectedView.ToString(), *CameraView.ToString()),
+	         CameraView.Equals(ExpectedView, 0.01f));
+
+	// The kick goes through the camera manager's view rotation processing like look input, so it respects the view
+	// pitch limits
+	CameraManager->ViewPitchMin = -1.0f;
+	CameraManager->ViewPitchMax = 1.0f;
+	TestWorld.Tick(DeltaTime);
+
+	const float LimitedPitch = FRotator::NormalizeAxis(CameraManager->GetCameraCacheView().Rotation.Pitch);
+	TestTrue(FString::Printf(TEXT("Recoil respects the view pitch limits (got %f)"), LimitedPitch),
+	         FMath::Abs(LimitedPitch) <= 1.0f + KINDA_SMALL_NUMBER);
+
+	Weapon->StopFire();
+	return true;
+}
+
+#endif
@@ -0,0 +1,139 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "FPSCoreTestWorld.h"
+#include "WeaponBase.h"
+#include "Components/BoxComponent.h"
+#include "Components/InventoryComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "HAL/LowLevelMemTracker.h"
+
+// Every allocation made while the measured frames are ticked is tracked under this tag, so that the test can read back
+// how much memory the frames left behind. The tracker is thread safe and installed before any other thread starts
+LLM_DEFINE_TAG(FPSCoreShotAllocationTest);
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FShotAllocationTest, "FPSCore.Weapon.SteadyStateShotsDontAllocate",
+                                 EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext |
+                                 EAutomationTestFlags::EngineFilter)
+
+bool FShotAllocationTest::RunTest(const FString& Parameters)
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (!FLowLevelMemTracker::IsEnabled())
+	{
+		AddInfo(TEXT("The low level memory tracker is disabled, run with -llm to measure the allocations made by shots"));
+		return true;
+	}
+
+	const FFPSCoreTestWorld TestWorld;
+	UWorld* World = TestWorld.Get();
+
+	// Two targets side by side in front of the player, so that the shots have more than one victim
+	for (const float TargetY : {-100.0f, 100.0f})
+	{
+		AActor* Target = World->SpawnActor<AActor>();
+		UBoxComponent* TargetBox = NewObject<UBoxComponent>(Target);
+		TargetBox->SetBoxExtent(FVector(50.0f, 100.0f, 200.0f));
+		TargetBox->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		Target->SetRootComponent(TargetBox);
+		TargetBox->SetWorldLocation(FVector(1000.0f, TargetY, 0.0f));
+		TargetBox->RegisterComponent();
+	}
+
+	AddExpectedError(TEXT("Set up data in MovementDataMap"), EAutomationExpectedErrorFlags::Contains, 1);
+	AFPSCharacterController* Controller = TestWorld.SpawnPlayer();
+	if (!TestNotNull(TEXT("Player"), Controller))
+	{
+		return false;
+	}
+	AFPSCharacter* Character = CastChecked<AFPSCharacter>(Controller->GetPawn());
+
+	// The character would report its missing movement data every frame, and every error reported to the test is
+	// recorded, so it is kept from ticking. The controller still processes input, advances the fire clock and turns
+	// the view
+	Character->SetActorTickEnabled(false);
+
+	// An inventory that hears about every hit batch, so that the test knows the shots are landing
+	UInventoryComponent* Inventory = NewObject<UInventoryComponent>(Character);
+	Inventory->RegisterComponent();
+	int32 NumShotsThatHit = 0;
+	Inventory->OnHitBatch.AddLambda([&NumShotsThatHit](const FHitBatch& HitBatch)
+	{
+		NumShotsThatHit += HitBatch.Victims.Num() > 0 ? 1 : 0;
+	});
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Owner = Character;
+	AWeaponBase* Weapon = World->SpawnActor<AWeaponBase>(AWeaponBase::StaticClass(), FTransform::Identity, SpawnParameters);
+	if (!TestNotNull(TEXT("Weapon"), Weapon))
+	{
+		return false;
+	}
+
+	// An automatic shotgun firing eight spread pellets once a frame
+	constexpr float DeltaTime = 1.0f / 60.0f;
+	FStaticWeaponData WeaponData = *Weapon->GetStaticWeaponData();
+	WeaponData.bAutomaticFire = true;
+	WeaponData.RateOfFire = 60.0f / DeltaTime;
+	WeaponData.bIsShotgun = true;
+	WeaponData.ShotgunPellets = 8;
+	WeaponData.ShotgunRange = 5000.0f;
+	WeaponData.WeaponPitchVariation = 3.0f;
+	WeaponData.WeaponYawVariation = 3.0f;
+	WeaponData.AccuracyDebuff = 1.0f;
+	WeaponData.BaseDamage = 10.0f;
+	Weapon->SetStaticWeaponData(WeaponData);
+
+	FRuntimeWeaponData RuntimeData = *Weapon->GetRuntimeWeaponData();
+	RuntimeData.ClipCapacity = 1000;
+	RuntimeData.ClipSize = 1000;
+	Weapon->SetRuntimeWeaponData(RuntimeData);
+
+	Weapon->SpawnAttachments();
+	Weapon->OnEquipped();
+
+	// Letting the targets settle into the physics scene before they are shot at
+	TestWorld.Tick(DeltaTime);
+
+	// Holding the trigger through every frame. The first frames grow the pools and buffers of the shot path, and
+	// once they have settled the measured frames must not leave any more memory behind
+	constexpr int32 NumWarmUpFrames = 30;
+	constexpr int32 NumMeasuredFrames = 60;
+	Weapon->StartFire();
+	for (int32 Frame = 0; Frame < NumWarmUpFrames; ++Frame)
+	{
+		TestWorld.Tick(DeltaTime);
+	}
+
+	const int32 AmmoBeforeMeasuring = Weapon->GetRuntimeWeaponData()->ClipSize;
+	const int32 ShotsThatHitBeforeMeasuring = NumShotsThatHit;
+	for (int32 Frame = 0; Frame < NumMeasuredFrames; ++Frame)
+	{
+		LLM_SCOPE_BYTAG(FPSCoreShotAllocationTest);
+		TestWorld.Tick(DeltaTime);
+	}
+	FLowLevelMemTracker::Get().UpdateStatsPerFrame();
+
+	Weapon->StopFire();
+
+	const int32 ShotsFired = AmmoBeforeMeasuring - Weapon->GetRuntimeWeaponData()->ClipSize;
+	TestTrue(FString::Printf(TEXT("Shots fired while measuring (%d)"), ShotsFired), ShotsFired >= NumMeasuredFrames - 1);
+	TestEqual(TEXT("Shots that hit the targets"), NumShotsThatHit - ShotsThatHitBeforeMeasuring, ShotsFired);
+
+	// The tracker attributes memory to the tag it was allocated under until it is freed, so anything still held under
+	// the tag is memory that the steady state shots allocated and kept
+	const int64 BytesHeld = FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default,
+	                                                                         TEXT("FPSCoreShotAllocationTest"),
+	                                                                         ELLMTagSet::None);
+	TestEqual(FString::Printf(TEXT("Bytes allocated and kept by %d shots once warmed up"), ShotsFired), BytesHeld, static_cast<int64>(0));
+#else
+	AddInfo(TEXT("The low level memory tracker isn't compiled in, so the allocations made by shots can't be measured"));
+#endif
+
+	return true;
+}
+
+#endif
@@ -1,11 +1,15 @@
 // Copyright 2022 Ellie Kelemen. All Rights Reserved.
 
 #include "WeaponBase.h"
+#include "FPSCore.h"
 #include "Animation/AnimationAsset.h"
+#include "Animation/AnimMontage.h"
 #include "Animation/AnimSequence.h"
 #include "Engine/Engine.h"
 #include "Kismet/GameplayStatics.h"
-#include "DrawDebugHelpers.h"
+#include "NiagaraComponent.h"
+#include "Components/AudioComponent.h"
+#include "NiagaraDataInterfaceArrayFunctionLibrary.h"
 #include "NiagaraFunctionLibrary.h"
 #include "Math/UnrealMathUtility.h"
 #include "FPSCharacterController.h"
@@ -17,12 +21,43 @@
 #include "Components/SkeletalMeshComponent.h"
 #include "Animation/AnimInstance.h"
 #include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "RecoilCameraModifier.h"
+#include "SpreadPattern.h"
+#include "AudioDevice.h"
+#include "NiagaraComponentPool.h"
+#include "NiagaraWorldManager.h"
+#include "Sound/SoundCue.h"
+#include "Sound/SoundNodeWavePlayer.h"
+#include "Sound/SoundWave.h"
+#include "HAL/IConsoleManager.h"
+#include "Subsystems/CosmeticSchedulerSubsystem.h"
+#include "Subsystems/ImpactDecalSubsystem.h"
+#include "Subsystems/ImpactEffectSubsystem.h"
+#include "Subsystems/NearMissSubsystem.h"
+#include "Subsystems/ProjectileSubsystem.h"
+#include "Subsystems/ShotDebugSubsystem.h"
+#include "Subsystems/ShotQueueSubsystem.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Ticking Weapons"), STAT_TickingWeapons, STATGROUP_FPSCore);
+
+static TAutoConsoleVariable<int32> CVarWarmUpAssetsPerFrame(
+    TEXT("fps.WarmUp.AssetsPerFrame"),
+    2,
+    TEXT("The number of assets that a newly spawned weapon warms up each frame."),
+    ECVF_Default);
 
 // Sets default values
 AWeaponBase::AWeaponBase()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+    // The fire clock and the recoil timelines run before physics, after the owner's controller has processed input (see
+    // UpdateTickPrerequisites)
+    PrimaryActorTick.TickGroup = TG_PrePhysics;
+    // Ticking is enabled on demand by UpdateTickEnabled
+    PrimaryActorTick.bStartWithTickEnabled = false;
 
     // Creating our weapon's skeletal mesh, telling it to not cast shadows and finally setting it as the root of the actor
     MeshComp = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("MeshComp"));
@@ -50,6 +85,11 @@ AWeaponBase::AWeaponBase()
     GripAttachment = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("GripAttachment"));
     GripAttachment->CastShadow = false;
     GripAttachment->SetupAttachment(RootComponent);
+
+    // Creating the persistent tracer system, which is only given an asset (and activated) if the weapon uses batched tracers
+    TracerComponent = CreateDefaultSubobject<UNiagaraComponent>(TEXT("TracerComponent"));
+    TracerComponent->SetupAttachment(RootComponent);
+    TracerComponent->bAutoActivate = false;
 }
 
 
@@ -67,6 +107,42 @@ void AWeaponBase::BeginPlay()
     {
         GEngine->AddOnScreenDebugMessage(-1, 10.0f, FColor::Red, TEXT("MISSING A WEAPON DATA TABLE NAME REFERENCE"));
     }
+
+    BuildSurfaceLookup();
+    BuildShotQueryParams();
+
+    if (WeaponData.BatchedBulletTrace)
+    {
+        TracerComponent->SetAsset(WeaponData.BatchedBulletTrace);
+    }
+
+    // Creating the voices that firing sounds are played through, rather than spawning an audio component per shot
+    FireVoices.Reset();
+    for (int32 Index = 0; Index < WeaponData.NumFireVoices + 1; ++Index)
+    {
+        UAudioComponent* Voice = NewObject<UAudioComponent>(this);
+        Voice->bAutoActivate = false;
+        Voice->bAutoDestroy = false;
+        Voice->SetupAttachment(RootComponent);
+        if (WeaponData.FireSoundConcurrency)
+        {
+            Voice->ConcurrencySet.Add(WeaponData.FireSoundConcurrency);
+        }
+        Voice->RegisterComponent();
+
+        // The last voice is kept aside for the firing loop
+        if (Index == WeaponData.NumFireVoices)
+        {
+            FireLoopVoice = Voice;
+        }
+        else
+        {
+            FireVoices.Add(Voice);
+        }
+    }
+
+    // Every weapon of the same type shares a spread seed, so that a shot can be reproduced anywhere from its sequence number
+    SpreadSeed = GetTypeHash(WeaponData.WeaponName.ToString());
     
     // Setting our default animation values
     // We set these here, but they can be overriden later by variables from applied attachments.
@@ -111,13 +187,6 @@ void AWeaponBase::BeginPlay()
         HorizontalRecoilProgressFunction.BindUFunction(this, FName("HandleHorizontalRecoilProgress"));
         HorizontalRecoilTimeline.AddInterpFloat(HorizontalRecoilCurve, HorizontalRecoilProgressFunction);
     }
-
-    if (RecoveryCurve)
-    {
-        FOnTimelineFloat RecoveryProgressFunction;
-        RecoveryProgressFunction.BindUFunction(this, FName("HandleRecoveryProgress"));
-        RecoilRecoveryTimeline.AddInterpFloat(RecoveryCurve, RecoveryProgressFunction);
-    }
 }
 
 void AWeaponBase::SpawnAttachments()
@@ -155,9 +224,12 @@ void AWeaponBase::SpawnAttachments()
                     WeaponData.VerticalRecoilCurve = AttachmentData->VerticalRecoilCurve;
                     WeaponData.HorizontalRecoilCurve = AttachmentData->HorizontalRecoilCurve;
                     WeaponData.RecoilCameraShake = AttachmentData->RecoilCameraShake;
+                    WeaponData.CameraKick = AttachmentData->CameraKick;
+                    WeaponData.CameraKickFrequency = AttachmentData->CameraKickFrequency;
                     WeaponData.bIsShotgun = AttachmentData->bIsShotgun;
                     WeaponData.ShotgunRange = AttachmentData->ShotgunRange;
                     WeaponData.ShotgunPellets = AttachmentData->ShotgunPellets;
+                    WeaponData.SpreadPattern = AttachmentData->SpreadPattern;
                     WeaponData.EmptyWeaponReload = AttachmentData->EmptyWeaponReload;
                     WeaponData.WeaponReload = AttachmentData->WeaponReload;
                     WeaponData.EmptyPlayerReload = AttachmentData->EmptyPlayerReload;
@@ -228,35 +300,134 @@ void AWeaponBase::SpawnAttachments()
             }
         }
     }
+
+    // The loadout is final at this point, so the recoil that it produces can be baked
+    BakeRecoilTable();
+}
+
+void AWeaponBase::BakeRecoilTable()
+{
+    RecoilTable.Pitch.Reset();
+    RecoilTable.Yaw.Reset();
+
+    if (!IsValid(WeaponData.VerticalRecoilCurve) || !IsValid(WeaponData.HorizontalRecoilCurve))
+    {
+        return;
+    }
+
+    // Sampling both curves at the time of every shot until their last keys, after which they hold their value (and so
+    // the last entry is repeated). Semi-automatic weapons only ever use the first entry
+    const float ShotInterval = GetShotInterval();
+    float MinTime, MaxTime, UnusedMinTime, VerticalMaxTime;
+    WeaponData.VerticalRecoilCurve->GetTimeRange(UnusedMinTime, VerticalMaxTime);
+    WeaponData.HorizontalRecoilCurve->GetTimeRange(MinTime, MaxTime);
+    MaxTime = FMath::Max(MaxTime, VerticalMaxTime);
+
+    constexpr int32 MaxBakedShots = 1024;
+    const int32 NumShots = WeaponData.bAutomaticFire
+                               ? FMath::Clamp(FMath::CeilToInt32(MaxTime / ShotInterval) + 1, 1, MaxBakedShots)
+                               : 1;
+    RecoilTable.Pitch.SetNumUninitialized(NumShots);
+    RecoilTable.Yaw.SetNumUninitialized(NumShots);
+
+    for (int32 Shot = 0; Shot < NumShots; ++Shot)
+    {
+        RecoilTable.Pitch[Shot] = WeaponData.VerticalRecoilCurve->GetFloatValue(ShotInterval * Shot) * VerticalRecoilModifier;
+        RecoilTable.Yaw[Shot] = WeaponData.HorizontalRecoilCurve->GetFloatValue(ShotInterval * Shot) * HorizontalRecoilModifier;
+    }
 }
 
 void AWeaponBase::StartFire()
 { 
     if (bCanFire)
     {
-        // sets a timer for firing the weapon - if bAutomaticFire is true then this timer will repeat until cleared by StopFire(), leading to fully automatic fire
-        GetWorldTimerManager().SetTimer(ShotDelay, this, &AWeaponBase::Fire, (60 / WeaponData.RateOfFire), WeaponData.bAutomaticFire, 0.0f);
+        // Holding the trigger - if bAutomaticFire is true then the fire clock keeps emitting shots in Tick until StopFire() is called
+        bTriggerHeld = true;
+
+        // Restarting the fire clock, unless rapid fire prevention is still waiting for the previous shot's interval to pass
+        if (bIsWeaponReadyToFire)
+        {
+            TimeUntilNextShot = 0.0f;
+        }
 
         if (bShowDebug)
         {
-            GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Orange, TEXT("Started firing timer"));
+            GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Orange, TEXT("Started fire clock"));
         }
 
         // Simultaneously engage recoil systems 
         StartRecoil();
+
+        // The first shot is fired straight away, subsequent ones come from the fire clock. If the clock has yet to be
+        // advanced this frame it is about to subtract the whole frame, so the press is stamped at the start of the
+        // frame to line up with the shots it goes on to emit. Otherwise the frame has already been accounted for and
+        // the press happens now
+        const double PressTime = FireClockFrame == GFrameCounter
+            ? GetWorld()->GetTimeSeconds()
+            : GetWorld()->GetTimeSeconds() - GetWorld()->GetDeltaSeconds();
+        
+        if (Fire(PressTime))
+        {
+            TimeUntilNextShot += GetShotInterval();
+        }
+
+        UpdateTickEnabled();
     }
     
 }
 
+void AWeaponBase::AdvanceFireClock(const float DeltaTime)
+{
+    if (FireClockFrame == GFrameCounter)
+    {
+        return;
+    }
+    FireClockFrame = GFrameCounter;
+    TickFireClock(DeltaTime);
+}
+
+void AWeaponBase::TickFireClock(const float DeltaTime)
+{
+    TimeUntilNextShot -= DeltaTime;
+
+    if (bTriggerHeld && WeaponData.bAutomaticFire)
+    {
+        // Emitting as many shots as the elapsed time allows, each stamped with the exact time within the frame at which
+        // it was due. Whatever time is left over is carried into the next frame, so the real rate of fire no longer
+        // depends on the frame rate
+        const double FrameTime = GetWorld()->GetTimeSeconds();
+        const float ShotInterval = GetShotInterval();
+        while (bTriggerHeld && TimeUntilNextShot <= 0.0f)
+        {
+            Fire(FrameTime + TimeUntilNextShot);
+            TimeUntilNextShot += ShotInterval;
+        }
+    }
+    else
+    {
+        // Shots can't be banked while the trigger is released
+        TimeUntilNextShot = FMath::Max(TimeUntilNextShot, 0.0f);
+    }
+
+    // Once the interval since the last shot has passed, rapid fire prevention allows the weapon to fire again
+    if (!bIsWeaponReadyToFire && TimeUntilNextShot <= 0.0f)
+    {
+        bIsWeaponReadyToFire = true;
+    }
+}
+
 void AWeaponBase::StartRecoil()
 {
-    const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
-    const AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    const AController* Controller = OwnerPawn ? OwnerPawn->GetController() : nullptr;
     
-    if (bCanFire && GeneralWeaponData.ClipSize > 0 && !bIsReloading && CharacterController)
+    if (bCanFire && GeneralWeaponData.ClipSize > 0 && !bIsReloading && Controller)
     {
-        // Plays the recoil timelines and saves the current control rotation in order to recover to it
-        ControlRotation = CharacterController->GetControlRotation();
+        // Saving the current control rotation in order to recover to it, unless we're still recovering to an earlier one
+        if (!bRecoveringRecoil)
+        {
+            ControlRotation = Controller->GetControlRotation();
+        }
         bShouldRecover = true;
     }
 }
@@ -267,11 +438,6 @@ void AWeaponBase::EnableFire()
     bCanFire = true;
 }
 
-void AWeaponBase::ReadyToFire()
-{
-    bIsWeaponReadyToFire = true;
-}
-
 void AWeaponBase::StopFire()
 {
     // Stops the gun firing (for automatic fire)
@@ -280,28 +446,29 @@ void AWeaponBase::StopFire()
     RecoilRecovery();
     ShotsFired = 0;
 
-    if (WeaponData.bPreventRapidManualFire && bHasFiredRecently)
+    // Preventing the weapon from firing again until the fire clock says the next shot is due
+    if (WeaponData.bPreventRapidManualFire && bHasFiredRecently && TimeUntilNextShot > 0.0f)
     {
-        GetWorldTimerManager().ClearTimer(SpamFirePreventionDelay);
-        const float TimeRemaining = GetWorldTimerManager().GetTimerRemaining(ShotDelay);
-        // GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, FString::SanitizeFloat(TimeRemaining));
-        if (TimeRemaining > 0.0f)
-        {
-            bHasFiredRecently = false;
-            bIsWeaponReadyToFire = false;
-            GetWorldTimerManager().SetTimer(SpamFirePreventionDelay, this, &AWeaponBase::ReadyToFire, GetWorldTimerManager().GetTimerRemaining(ShotDelay), false, GetWorldTimerManager().GetTimerRemaining(ShotDelay));
-        }
+        bHasFiredRecently = false;
+        bIsWeaponReadyToFire = false;
     }
-    GetWorldTimerManager().ClearTimer(ShotDelay);
+    bTriggerHeld = false;
+
+    StopFireLoop();
+    UpdateTickEnabled();
 }
 
-void AWeaponBase::Fire()
+bool AWeaponBase::Fire(const double ShotTime)
 {    
     // Allowing the gun to fire if it has ammunition, is not reloading and the bCanFire variable is true
     if(bCanFire && bIsWeaponReadyToFire && GeneralWeaponData.ClipSize > 0 && !bIsReloading)
     {
-        // Casting to the player character
-        const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+        // Shots are resolved in the order they are fired, so their timestamps must never run backwards
+        ensureMsgf(ShotTime >= LastShotTime, TEXT("Shot at %f was fired after a shot at %f"), ShotTime, LastShotTime);
+        LastShotTime = ShotTime;
+        
+        // Shooting from the view point of whoever is holding the weapon
+        const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(GetOwner());
     
         // Printing debug strings
         if(bShowDebug)
@@ -312,51 +479,83 @@ void AWeaponBase::Fire()
 
         GunFired();
 
+        // Deciding how much of this shot the local viewer gets to see and hear. Animations and effects are skipped for
+        // shooters that are far away or off screen, and everything cosmetic is skipped on a dedicated server
+        CosmeticLOD = EvaluateCosmeticLOD();
+        const bool bPlayAnimations = CosmeticLOD <= ECosmeticLOD::Reduced;
+
         // Subtracting from the ammunition count of the weapon
         GeneralWeaponData.ClipSize -= 1;
 
-        const int NumberOfShots = WeaponData.bIsShotgun? WeaponData.ShotgunPellets : 1;
-        // We run this for the number of bullets/projectiles per shot, in order to support shotguns
-        for (int i = 0; i < NumberOfShots; i++)
+        bool bIsAiming = false;
+        if (PlayerCharacter)
         {
-            // Calculating the start and end points of our line trace, and applying randomised variation
+            // Calculating the start point of our shot
             TraceStart = PlayerCharacter->GetCameraComponent()->GetComponentLocation();
-            TraceStartRotation = PlayerCharacter->GetCameraComponent()->GetComponentRotation();
 
-            float AccuracyMultiplier = 1.0f;
-            if (!PlayerCharacter->IsPlayerAiming())
-            {
-                AccuracyMultiplier = WeaponData.AccuracyDebuff;
-            }
-            
-            TraceStartRotation.Pitch += FMath::FRandRange(
-                -((WeaponData.WeaponPitchVariation + WeaponPitchModifier) * AccuracyMultiplier),
-                (WeaponData.WeaponPitchVariation + WeaponPitchModifier) * AccuracyMultiplier);
-            TraceStartRotation.Yaw += FMath::FRandRange(
-                -((WeaponData.WeaponYawVariation + WeaponYawModifier) * AccuracyMultiplier),
-                (WeaponData.WeaponYawVariation + WeaponYawModifier) * AccuracyMultiplier);
-            TraceDirection = TraceStartRotation.Vector();
-            TraceEnd = TraceStart + (TraceDirection * (WeaponData.bIsShotgun
-                                                           ? WeaponData.ShotgunRange
-                                                           : WeaponData.LengthMultiplier));
-            
+            // Reconstructing where the player was aiming at the moment the shot was due. Several shots can fall within
+            // one frame at high rates of fire, and each should follow the look input that came before it rather than
+            // all using the aim at the end of the frame. The camera keeps its animated offset on top of the aim
+            const FRotator AimOffset = (PlayerCharacter->GetAimRotationAtTime(ShotTime) - PlayerCharacter->GetControlRotation()).GetNormalized();
+            TraceStartRotation = PlayerCharacter->GetCameraComponent()->GetComponentRotation() + AimOffset;
+
+            bIsAiming = PlayerCharacter->IsPlayerAiming();
+        }
+        else if (const AActor* WeaponOwner = GetOwner())
+        {
+            // Any other holder shoots from its eyes, which for a controlled pawn is its controller's view point
+            WeaponOwner->GetActorEyesViewPoint(TraceStart, TraceStartRotation);
+        }
+        else
+        {
+            GetActorEyesViewPoint(TraceStart, TraceStartRotation);
+        }
 
-            // Applying Recoil to the weapon
-            Recoil();
+        const float AccuracyMultiplier = bIsAiming ? 1.0f : WeaponData.AccuracyDebuff;
 
-            // Playing an animation on the weapon mesh
-            if (WeaponData.WeaponShot)
+        FShotRequest ShotRequest;
+        ShotRequest.Weapon = this;
+        ShotRequest.Origin = TraceStart;
+        ShotRequest.Range = WeaponData.bIsShotgun ? WeaponData.ShotgunRange : WeaponData.LengthMultiplier;
+        ShotRequest.TraceChannel = GetShotTraceChannel();
+
+        // Using the query parameters built once for this weapon (their ignore lists are stored inline, so copying them
+        // doesn't allocate)
+        ShotRequest.QueryParams = ShotQueryParams;
+
+        // Penetration and ricochets are resolved by the shot queue against the weapon's surface table
+        ShotRequest.Surfaces = SurfaceLookup;
+        ShotRequest.PenetrationPower = WeaponData.PenetrationPower;
+        ShotRequest.MaxRicochets = WeaponData.MaxRicochets;
+        ShotRequest.CosmeticLOD = CosmeticLOD;
+
+        // Calculating the direction of every pellet, with spread drawn from this shot's seeded stream
+        ComputePelletDirections(TraceStartRotation, ShotSequence++, AccuracyMultiplier, ShotRequest.Directions);
+
+        // Applying recoil once for the whole shot, however many pellets it fires, so that each shot takes one entry
+        // of the recoil table and gives the camera one kick
+        Recoil();
+
+        // Playing an animation on the weapon mesh
+        if (WeaponData.WeaponShot)
+        {
+            if (bPlayAnimations)
             {
                 MeshComp->PlayAnimation(GeneralWeaponData.ClipSize == 0? WeaponData.LastWeaponShot : WeaponData.WeaponShot, false);
-                if (WeaponData.bWaitForAnim)
-                {
-                    // Preventing the player from firing the weapon until the animation finishes playing 
-                    const float AnimWaitTime = WeaponData.WeaponShot->GetPlayLength();
-                    bCanFire = false;
-                    GetWorldTimerManager().SetTimer(AnimationWaitDelay, this, &AWeaponBase::EnableFire, AnimWaitTime, false, AnimWaitTime);
-                }
             }
-            if (PlayerCharacter->IsPlayerAiming())
+            // The wait still applies when the animation is culled, as it limits the weapon's rate of fire
+            if (WeaponData.bWaitForAnim)
+            {
+                // Preventing the player from firing the weapon until the animation finishes playing, measured
+                // from the moment the shot was due rather than the end of the frame
+                const float AnimWaitTime = FMath::Max(WeaponData.WeaponShot->GetPlayLength() - static_cast<float>(GetWorld()->GetTimeSeconds() - ShotTime), KINDA_SMALL_NUMBER);
+                bCanFire = false;
+                GetWorldTimerManager().SetTimer(AnimationWaitDelay, this, &AWeaponBase::EnableFire, AnimWaitTime, false, AnimWaitTime);
+            }
+        }
+        if (bPlayAnimations && PlayerCharacter)
+        {
+            if (bIsAiming)
             {
                 if (WeaponData.HandsADSShot)
                 {
@@ -370,164 +569,72 @@ void AWeaponBase::Fire()
                    PlayerCharacter->GetHandsMesh()->GetAnimInstance()->Montage_Play(WeaponData.HandsShot); 
                 }
             }
+        }
 
-            FVector EndPoint = TraceEnd;
-
-            	
-            /** collision parameters for spawning the line trace */
-            FCollisionQueryParams QueryParams;
-
-            //Sets the default values for our trace query
-            QueryParams.AddIgnoredActor(this);
-            QueryParams.bTraceComplex = true;
-            QueryParams.bReturnPhysicalMaterial = true;
-
-            // Drawing a line trace based on the parameters calculated previously 
-            if(GetWorld()->LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, ECC_GameTraceChannel1, QueryParams))
-            {                
-                // Drawing debug line trace
-                if (bShowDebug)
-                {
-                    // Debug line from muzzle to hit location
-                    DrawDebugLine(
-                        GetWorld(), (WeaponData.bHasAttachments
-                                         ? BarrelAttachment->GetSocketLocation(WeaponData.MuzzleLocation)
-                                         : MeshComp->GetSocketLocation(WeaponData.MuzzleLocation)), Hit.Location,
-                                         FColor::Red, false, 10.0f, 0.0f, 2.0f);
-
-                    if (bDrawObstructiveDebugs)
-                    {
-                        // Debug line from camera to hit location
-                        DrawDebugLine(GetWorld(), TraceStart, Hit.Location,FColor::Orange, false, 10.0f, 0.0f, 2.0f);
-
-                        // Debug line from camera to target location
-                        DrawDebugLine(GetWorld(), TraceStart, TraceEnd, FColor::Green, false, 10.0f, 0.0f, 2.0f);
-                    }
-                }
-                
-                // Resetting finalDamage
-                FinalDamage = 0.0f;
-
-                // Setting finalDamage based on the type of surface hit
-                FinalDamage = (WeaponData.BaseDamage + DamageModifier);
-                
-                if (Hit.PhysMaterial.Get() == WeaponData.HeadshotDamageSurface)
-                {
-                    FinalDamage = (WeaponData.BaseDamage + DamageModifier) * WeaponData.HeadshotMultiplier;
-                }
-
-                AActor* HitActor = Hit.GetActor();
-
-                // Applying the previously set damage to the hit actor
-                UGameplayStatics::ApplyPointDamage(HitActor, FinalDamage, TraceDirection, Hit,
-                                                   GetOwner()->GetInstigatorController(), this, DamageType);
-
-                EndPoint = Hit.Location;
-
-                // Passing hit delegate to InventoryComponent
-                AFPSCharacter* PlayerRef = Cast<AFPSCharacter>(GetOwner());
-                if (PlayerRef)
-                {
-                    UInventoryComponent* PlayerInventoryComp = PlayerRef->FindComponentByClass<UInventoryComponent>();
-                    if (IsValid(PlayerInventoryComp))
-                    {
-                        PlayerInventoryComp->EventHitActor.Broadcast(Hit);
-                    }
-                }
-            }
-            else
+        if (WeaponData.BallisticsMode == EBallisticsMode::Projectile)
+        {
+            // Launching a simulated projectile for every pellet, which calls back into ApplyImpact once it lands
+            if (UProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UProjectileSubsystem>())
             {
-                // Drawing debug line trace
-                if (bShowDebug)
+                FProjectileLaunchParams LaunchParams;
+                LaunchParams.Weapon = this;
+                LaunchParams.Origin = TraceStart;
+                LaunchParams.DragCoefficient = WeaponData.ProjectileDrag;
+                LaunchParams.GravityZ = GetWorld()->GetGravityZ() * WeaponData.ProjectileGravityScale;
+                LaunchParams.Lifetime = WeaponData.ProjectileLifetime;
+                LaunchParams.TraceChannel = ShotRequest.TraceChannel;
+                LaunchParams.bTraceComplex = ShotRequest.QueryParams.bTraceComplex;
+                LaunchParams.CosmeticLOD = CosmeticLOD;
+                
+                for (const FVector& Direction : ShotRequest.Directions)
                 {
-                    DrawDebugLine(
-                        GetWorld(), (WeaponData.bHasAttachments
-                                         ? BarrelAttachment->GetSocketLocation(WeaponData.MuzzleLocation)
-                                         : MeshComp->GetSocketLocation(WeaponData.MuzzleLocation)), TraceEnd,
-                        FColor::Red, false, 10.0f, 0.0f, 2.0f);
-
-                    if (bDrawObstructiveDebugs)
-                    {
-                        // Debug line from camera to target location
-                        DrawDebugLine(GetWorld(), TraceStart, TraceEnd, FColor::Green, false, 10.0f, 0.0f, 2.0f);
-                    }
+                    LaunchParams.Velocity = Direction * WeaponData.MuzzleVelocity;
+                    Projectiles->LaunchProjectile(LaunchParams);
                 }
             }
-
-            const FRotator ParticleRotation = (EndPoint - (WeaponData.bHasAttachments
-                                                               ? BarrelAttachment->GetSocketLocation(
-                                                                   WeaponData.MuzzleLocation)
-                                                               : MeshComp->GetSocketLocation(
-                                                                   WeaponData.MuzzleLocation))).Rotation();
-            
-            // Spawning the bullet trace particle effect
-            if (WeaponData.bHasAttachments)
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.BulletTrace,
-                                                         BarrelAttachment->GetSocketLocation(
-                                                             WeaponData.ParticleSpawnLocation), ParticleRotation);
-            }
-            else
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.BulletTrace,
-                                                         MeshComp->GetSocketLocation(WeaponData.ParticleSpawnLocation),
-                                                         ParticleRotation);
-            }
-
-            // Selecting the hit effect based on the hit physical surface material (hit.PhysMaterial.Get()) and spawning it (Niagara)
-
-            if (Hit.PhysMaterial.Get() == WeaponData.NormalDamageSurface || Hit.PhysMaterial.Get() == WeaponData.HeadshotDamageSurface)
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.EnemyHitEffect, Hit.ImpactPoint,
-                                                               Hit.ImpactNormal.Rotation());
-            }
-            else if (Hit.PhysMaterial.Get() == WeaponData.GroundSurface)
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.GroundHitEffect, Hit.ImpactPoint,
-                                                               Hit.ImpactNormal.Rotation());
-            }
-            else if (Hit.PhysMaterial.Get() == WeaponData.RockSurface)
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.RockHitEffect, Hit.ImpactPoint,
-                                                               Hit.ImpactNormal.Rotation());
-            }
-            else
-            {
-                UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.DefaultHitEffect, Hit.ImpactPoint,
-                                                               Hit.ImpactNormal.Rotation());
-            }
         }
-
-        // Spawning the muzzle flash particle
-        if (WeaponData.bHasAttachments)
+        // Handing the shot over to the shot queue, which traces every pellet fired this frame in a single batch and
+        // then calls back into ResolveShot to apply damage and spawn impact effects
+        else if (UShotQueueSubsystem* ShotQueue = GetWorld()->GetSubsystem<UShotQueueSubsystem>())
         {
-            UNiagaraFunctionLibrary::SpawnSystemAttached(WeaponData.MuzzleFlash, BarrelAttachment, WeaponData.ParticleSpawnLocation,
-                                                    FVector::ZeroVector,
-                                                    FRotator::ZeroRotator, EAttachLocation::SnapToTarget, true);
+            ShotQueue->SubmitShot(MoveTemp(ShotRequest));
         }
         else
         {
-            UNiagaraFunctionLibrary::SpawnSystemAttached(WeaponData.MuzzleFlash, MeshComp, WeaponData.ParticleSpawnLocation,
-                                                   FVector::ZeroVector,
-                                                   FRotator::ZeroRotator, EAttachLocation::SnapToTarget, true);
+            UE_LOG(LogProfilingDebugging, Error, TEXT("No shot queue found in the current world, shot from %s was discarded"), *GetName());
         }
 
-        // Spawning the firing sound
-        if(WeaponData.bSilenced)
+        // Handing the muzzle flash, firing sound and ejected casing over to the cosmetic scheduler, which plays them
+        // within the frame's cosmetic budget
+        EShotCosmetics Cosmetics = EShotCosmetics::None;
+        if (CosmeticLOD <= ECosmeticLOD::Reduced)
         {
-            UGameplayStatics::PlaySoundAtLocation(GetWorld(), WeaponData.SilencedSound, TraceStart);
+            Cosmetics |= EShotCosmetics::MuzzleFlash;
         }
-        else
+        if (CosmeticLOD == ECosmeticLOD::Full)
         {
-            UGameplayStatics::PlaySoundAtLocation(GetWorld(), WeaponData.FireSound, TraceStart);
+            Cosmetics |= EShotCosmetics::Casing;
+        }
+        if (CosmeticLOD != ECosmeticLOD::None)
+        {
+            Cosmetics |= EShotCosmetics::Sound;
         }
 
-
-        FRotator EjectionSpawnVector = FRotator::ZeroRotator;
-        EjectionSpawnVector.Yaw = 270.0f;
-        UNiagaraFunctionLibrary::SpawnSystemAttached(EjectedCasing, MagazineAttachment, FName("ejection_port"),
-                                                     FVector::ZeroVector, EjectionSpawnVector,
-                                                     EAttachLocation::SnapToTarget, true, true);
+        if (UCosmeticSchedulerSubsystem* CosmeticScheduler = GetWorld()->GetSubsystem<UCosmeticSchedulerSubsystem>())
+        {
+            // Only the local human player's shots skip the budget. Bots are locally controlled too, and would otherwise
+            // take every firefight's cosmetics out of the budget
+            const ECosmeticPriority Priority = IsHeldByLocalPlayer()
+                                                   ? ECosmeticPriority::LocalPlayer
+                                                   : CosmeticLOD <= ECosmeticLOD::Reduced
+                                                   ? ECosmeticPriority::OnScreen
+                                                   : ECosmeticPriority::OffScreen;
+            CosmeticScheduler->ScheduleCosmetics(this, Cosmetics, Priority);
+        }
+        else
+        {
+            PlayShotCosmetics(Cosmetics);
+        }
 
         if (!WeaponData.bAutomaticFire)
         {
@@ -535,12 +642,15 @@ void AWeaponBase::Fire()
         }
 
         bHasFiredRecently = true;
+        return true;
     }
-    else if (bCanFire && !bIsReloading)
+    
+    if (bCanFire && !bIsReloading)
     {
-        UGameplayStatics::PlaySoundAtLocation(GetWorld(), WeaponData.EmptyFireSound, MeshComp->GetSocketLocation(WeaponData.MuzzleLocation));
-        // Clearing the ShotDelay timer so that we don't have a constant ticking when the player has no ammo, just a single click
-        GetWorldTimerManager().ClearTimer(ShotDelay);
+        StopFireLoop();
+        PlayWeaponSound(WeaponData.EmptyFireSound);
+        // Stopping the fire clock so that we don't have a constant ticking when the player has no ammo, just a single click
+        bTriggerHeld = false;
 
         if (WeaponData.bAutoReload && GeneralWeaponData.ClipSize == 0)
         {
@@ -549,135 +659,1051 @@ void AWeaponBase::Fire()
         
         RecoilRecovery();
     }
-    
-}
-
-void AWeaponBase::Recoil()
-{
-    const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
-    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
-
-    // Apply recoil by adding a pitch and yaw input to the character controller
-    if (WeaponData.bAutomaticFire && CharacterController && ShotsFired > 0 && IsValid(WeaponData.VerticalRecoilCurve) && IsValid(WeaponData.HorizontalRecoilCurve))
-    {
-        CharacterController->AddPitchInput(WeaponData.VerticalRecoilCurve->GetFloatValue((60 / WeaponData.RateOfFire) * ShotsFired) * VerticalRecoilModifier);
-        CharacterController->AddYawInput(WeaponData.HorizontalRecoilCurve->GetFloatValue((60 / WeaponData.RateOfFire) * ShotsFired) * HorizontalRecoilModifier);
-    }
-    else if (CharacterController && ShotsFired <= 0 && IsValid(WeaponData.VerticalRecoilCurve) && IsValid(WeaponData.HorizontalRecoilCurve))
-    {
-        CharacterController->AddPitchInput(WeaponData.VerticalRecoilCurve->GetFloatValue(0) * VerticalRecoilModifier);
-        CharacterController->AddYawInput(WeaponData.HorizontalRecoilCurve->GetFloatValue(0) * HorizontalRecoilModifier);
-    }
 
-    ShotsFired += 1;
-    GetWorld()->GetFirstPlayerController()->ClientStartCameraShake(WeaponData.RecoilCameraShake);  
+    return false;
 }
 
-void AWeaponBase::RecoilRecovery()
+void AWeaponBase::ResolveShot(const TArrayView<const FPelletResult> Pellets, const ECosmeticLOD LOD)
 {
-    // Plays the recovery timeline
-    if (bShouldRecover)
+    const FVector MuzzleLocation = WeaponData.bHasAttachments
+                                       ? BarrelAttachment->GetSocketLocation(WeaponData.MuzzleLocation)
+                                       : MeshComp->GetSocketLocation(WeaponData.MuzzleLocation);
+    const FVector ParticleSpawnLocation = WeaponData.bHasAttachments
+                                              ? BarrelAttachment->GetSocketLocation(WeaponData.ParticleSpawnLocation)
+                                              : MeshComp->GetSocketLocation(WeaponData.ParticleSpawnLocation);
+
+    // Recording the shot's debug lines, which the shot debug recorder draws in one batch along with the last few shots
+    UShotDebugSubsystem* ShotDebug = bShowDebug || UShotDebugSubsystem::IsRecordingAllShots()
+                                         ? GetWorld()->GetSubsystem<UShotDebugSubsystem>()
+                                         : nullptr;
+    if (ShotDebug)
     {
-        RecoilRecoveryTimeline.PlayFromStart();
+        ShotDebug->BeginShot(this);
     }
-}
 
+    UNearMissSubsystem* NearMisses = GetWorld()->GetSubsystem<UNearMissSubsystem>();
 
-bool AWeaponBase::Reload()
-{
-    if (!bCanReload)
+    // Making room in the hit batch for a victim per pellet up front. The batch keeps its memory between shots, so it is
+    // only ever grown by the first shot to need the room, rather than once per new victim
+    int32 NumImpacts = 0;
+    for (const FPelletResult& Pellet : Pellets)
     {
-        return false;
+        NumImpacts += Pellet.Impacts.Num();
     }
+    HitBatch.Hits.Reserve(NumImpacts);
+    HitBatch.Victims.Reserve(NumImpacts);
+    PendingDamageEvents.Reserve(NumImpacts);
 
-    // Calling a blueprint implementable reload function
-    StartReload();
+    // The actors damaged by the pellet being resolved, which none of its segments count as a near miss for
+    TArray<AActor*, TInlineAllocator<8>> PelletVictims;
     
-    // Casting to the character controller (which stores all the ammunition and health variables)
-    const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
-    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
-
-    // Changing the maximum ammunition based on if the weapon can hold a bullet in the chamber
-    int Value = 0;
-    if (WeaponData.bCanBeChambered)
+    for (const FPelletResult& Pellet : Pellets)
     {
-        Value = 1;
-    }
+        PelletVictims.Reset();
 
-    // Checking if we are not reloading, if a reloading montage exists, and if there is any point in reloading
-    // (current ammunition does not match maximum magazine capacity and there is spare ammunition to load into the gun)
-    if (CharacterController->AmmoMap.Contains(GeneralWeaponData.AmmoType))
-    {
-        if (!bIsReloading && CharacterController->AmmoMap[GeneralWeaponData.AmmoType] > 0 && (GeneralWeaponData.ClipSize
-            !=
-            (GeneralWeaponData.ClipCapacity + Value)))
-        {
-            // Differentiating between having no ammunition in the magazine (having to chamber a round after reloading)
-            // or not, and playing an animation relevant to that
-            if (GeneralWeaponData.ClipSize <= 0 && WeaponData.EmptyPlayerReload)
+        const FVector TraceEnd = Pellet.Start + Pellet.Direction * (WeaponData.bIsShotgun
+                                                                        ? WeaponData.ShotgunRange
+                                                                        : WeaponData.LengthMultiplier);
+        
+        if (Pellet.bBlockingHit)
+        {                
+            // Recording debug line trace
+            if (ShotDebug)
             {
-                if (WeaponData.bHasAttachments)
+                // Debug line from muzzle to hit location
+                ShotDebug->AddLine(MuzzleLocation, Pellet.End, FColor::Red);
+
+                // Debug lines for each ricochet
+                FVector SegmentStart = Pellet.End;
+                for (const FVector& SegmentEnd : Pellet.RicochetEnds)
                 {
-                    MagazineAttachment->PlayAnimation(WeaponData.EmptyWeaponReload, false);
+                    ShotDebug->AddLine(SegmentStart, SegmentEnd, FColor::Yellow);
+                    SegmentStart = SegmentEnd;
                 }
-                else
+
+                if (bDrawObstructiveDebugs)
                 {
-                    MeshComp->PlayAnimation(WeaponData.EmptyWeaponReload, false);
-                }
+                    // Debug line from camera to hit location
+                    ShotDebug->AddLine(Pellet.Start, Pellet.End, FColor::Orange);
 
-                AnimTime = PlayerCharacter->GetHandsMesh()->GetAnimInstance()->Montage_Play(
-                    WeaponData.EmptyPlayerReload, 1.0f);
+                    // Debug line from camera to target location
+                    ShotDebug->AddLine(Pellet.Start, TraceEnd, FColor::Green);
+                }
             }
-            else if (WeaponData.PlayerReload)
+            
+            // Accumulating damage and spawning the impact effect for every surface that the pellet reached
+            for (const FPelletImpact& Impact : Pellet.Impacts)
             {
-                if (WeaponData.bHasAttachments)
+                AddImpactToBatch(Impact.Hit, Impact.Direction, Impact.DamageScale, LOD);
+                if (AActor* HitActor = Impact.Hit.GetActor())
                 {
-                    MagazineAttachment->PlayAnimation(WeaponData.WeaponReload, false);
+                    PelletVictims.AddUnique(HitActor);
                 }
-                else
+            }
+        }
+        else
+        {
+            // Recording debug line trace
+            if (ShotDebug)
+            {
+                ShotDebug->AddLine(MuzzleLocation, TraceEnd, FColor::Red);
+
+                if (bDrawObstructiveDebugs)
                 {
-                    MeshComp->PlayAnimation(WeaponData.WeaponReload, false);
+                    // Debug line from camera to target location
+                    ShotDebug->AddLine(Pellet.Start, TraceEnd, FColor::Green);
                 }
-                AnimTime = PlayerCharacter->GetHandsMesh()->GetAnimInstance()->Montage_Play(
-                    WeaponData.PlayerReload, 1.0f);
             }
-            else
+        }
+
+        // Handing every segment that the pellet travelled to near miss detection, which reuses the path already traced.
+        // Every segment carries all the actors that the pellet damaged, whether it stopped in them, passed through them or
+        // glanced off them, so that a round that hit someone is never also a near miss for them
+        if (NearMisses)
+        {
+            NearMisses->AddSegment(Pellet.Start, Pellet.End, this, PelletVictims);
+            FVector SegmentStart = Pellet.End;
+            for (const FVector& SegmentEnd : Pellet.RicochetEnds)
             {
-                AnimTime = 2.0f;
+                NearMisses->AddSegment(SegmentStart, SegmentEnd, this, PelletVictims);
+                SegmentStart = SegmentEnd;
             }
+        }
 
-            // Printing debug strings
-            if (bShowDebug)
+        // Adding the bullet trace from the barrel (or the mesh, if there is no barrel attachment), and along each ricochet.
+        // Shots at reduced cosmetics only draw the tracer of their first pellet
+        if (LOD == ECosmeticLOD::Full || (LOD == ECosmeticLOD::Reduced && &Pellet == Pellets.GetData()))
+        {
+            AddTracer(ParticleSpawnLocation, Pellet.End);
+        }
+        if (LOD == ECosmeticLOD::Full)
+        {
+            FVector RicochetStart = Pellet.End;
+            for (const FVector& RicochetEnd : Pellet.RicochetEnds)
             {
-                GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, "Reload", true);
+                AddTracer(RicochetStart, RicochetEnd);
+                RicochetStart = RicochetEnd;
             }
+        }
+    }
 
-            // Setting variables to make sure that the player cannot fire or reload during the time that the weapon is in it's reloading animation
-            bCanFire = false;
-            bIsReloading = true;
+    // Drawing every tracer of the shot with a single upload
+    UploadTracers();
 
-            // Starting the timer alongside the animation of the weapon reloading, casting to UpdateAmmo when it finishes
-            GetWorldTimerManager().SetTimer(ReloadingDelay, this, &AWeaponBase::UpdateAmmo, AnimTime, false, AnimTime);
-        }
+    // Applying the damage of every pellet at once, so that each victim only takes damage once for the whole shot
+    ApplyHitBatch();
+}
+
+void AWeaponBase::AddTracer(const FVector& Start, const FVector& End)
+{
+    if (!WeaponData.BatchedBulletTrace)
+    {
+        // Spawning a bullet trace particle effect per tracer if the weapon doesn't use batched tracers
+        UNiagaraFunctionLibrary::SpawnSystemAtLocation(GetWorld(), WeaponData.BulletTrace, Start, (End - Start).Rotation(),
+                                                       FVector(1.0f), true, true, ENCPoolMethod::AutoRelease);
+        return;
     }
 
-    return true;
+    // Starting a new batch on the first tracer of each frame. Several shots can land in the same frame, so every tracer
+    // added during a frame is kept until the next one
+    if (TracerFrame != GFrameCounter)
+    {
+        TracerFrame = GFrameCounter;
+        TracerStarts.Reset();
+        TracerEnds.Reset();
+        TracerTimes.Reset();
+    }
+
+    TracerStarts.Add(Start);
+    TracerEnds.Add(End);
+    TracerTimes.Add(GetWorld()->GetTimeSeconds());
 }
 
-void AWeaponBase::UpdateAmmo()
+void AWeaponBase::UploadTracers()
 {
-    // Calling a blueprint implementable function signifying the end of a reload
-    FinishReload();
-    
-    // Printing debug strings
-    if(bShowDebug)
+    if (!WeaponData.BatchedBulletTrace || TracerFrame != GFrameCounter || TracerStarts.Num() == 0)
     {
-        GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, "UpdateAmmo", true);
+        return;
     }
 
-    // Casting to the game instance (which stores all the ammunition and health variables)
-    AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
-    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
+    static const FName TracerStartsName(TEXT("User.TracerStarts"));
+    static const FName TracerEndsName(TEXT("User.TracerEnds"));
+    static const FName TracerTimesName(TEXT("User.TracerTimes"));
+    static const FName TracerBatchName(TEXT("User.TracerBatch"));
+    
+    UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayPosition(TracerComponent, TracerStartsName, TracerStarts);
+    UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayPosition(TracerComponent, TracerEndsName, TracerEnds);
+    UNiagaraDataInterfaceArrayFunctionLibrary::SetNiagaraArrayFloat(TracerComponent, TracerTimesName, TracerTimes);
+    TracerComponent->SetVariableInt(TracerBatchName, ++TracerBatch);
+
+    if (!TracerComponent->IsActive())
+    {
+        TracerComponent->Activate();
+    }
+}
+
+void AWeaponBase::ApplyImpact(const FHitResult& Hit, const FVector& ShotDirection, const ECosmeticLOD LOD, const float DamageScale)
+{
+    AddImpactToBatch(Hit, ShotDirection, DamageScale, LOD);
+    ApplyHitBatch();
+}
+
+void AWeaponBase::AddImpactToBatch(const FHitResult& Hit, const FVector& ShotDirection, const float DamageScale, const ECosmeticLOD LOD)
+{
+    // Setting finalDamage based on the type of surface hit
+    FinalDamage = (WeaponData.BaseDamage + DamageModifier);
+
+    const bool bHeadshot = IsHeadshot(Hit);
+    if (bHeadshot)
+    {
+        FinalDamage = (WeaponData.BaseDamage + DamageModifier) * WeaponData.HeadshotMultiplier;
+    }
+
+    // Scaling down damage for rounds that have passed through or glanced off other surfaces
+    FinalDamage *= DamageScale;
+
+    HitBatch.Hits.Add(Hit);
+
+    // Accumulating the damage against the hit actor, so that it only takes damage once for the whole shot
+    if (AActor* HitActor = Hit.GetActor())
+    {
+        int32 VictimIndex = HitBatch.Victims.IndexOfByPredicate([HitActor](const FHitBatchVictim& Victim)
+        {
+            return Victim.Actor.Get() == HitActor;
+        });
+        
+        if (VictimIndex == INDEX_NONE)
+        {
+            VictimIndex = HitBatch.Victims.AddDefaulted();
+            HitBatch.Victims[VictimIndex].Actor = HitActor;
+            
+            FShotDamageEvent& NewEvent = PendingDamageEvents.AddDefaulted_GetRef();
+            NewEvent.DamageTypeClass = DamageType;
+            NewEvent.HitInfo = Hit;
+            NewEvent.ShotDirection = ShotDirection;
+        }
+
+        FHitBatchVictim& Victim = HitBatch.Victims[VictimIndex];
+        FShotDamageEvent& DamageEvent = PendingDamageEvents[VictimIndex];
+        
+        Victim.Damage += FinalDamage;
+        Victim.NumHits++;
+        DamageEvent.NumHits++;
+        DamageEvent.HitBones.Add(Hit.BoneName);
+        
+        if (bHeadshot)
+        {
+            // The first headshot becomes the hit reported to the victim
+            if (DamageEvent.NumHeadshots == 0)
+            {
+                DamageEvent.HitInfo = Hit;
+                DamageEvent.ShotDirection = ShotDirection;
+            }
+            Victim.NumHeadshots++;
+            DamageEvent.NumHeadshots++;
+        }
+    }
+
+    SpawnImpactEffect(Hit, LOD);
+}
+
+void AWeaponBase::ApplyHitBatch()
+{
+    if (HitBatch.Hits.Num() == 0)
+    {
+        return;
+    }
+    
+    AController* InstigatorController = GetOwner() ? GetOwner()->GetInstigatorController() : nullptr;
+
+    // Applying the accumulated damage once per victim
+    for (int32 VictimIndex = 0; VictimIndex < HitBatch.Victims.Num(); ++VictimIndex)
+    {
+        FHitBatchVictim& Victim = HitBatch.Victims[VictimIndex];
+        FShotDamageEvent& DamageEvent = PendingDamageEvents[VictimIndex];
+        
+        if (AActor* HitActor = Victim.Actor.Get())
+        {
+            // Actors that can't be damaged are left out of the engine's damage handling altogether
+            if (Victim.Damage != 0.0f && HitActor->CanBeDamaged())
+            {
+                HitActor->TakeDamage(Victim.Damage, DamageEvent, InstigatorController, this);
+            }
+
+            // Passing hit delegate to InventoryComponent
+            if (IsValid(OwnerInventoryComponent))
+            {
+                OwnerInventoryComponent->EventHitActor.Broadcast(DamageEvent.HitInfo);
+            }
+        }
+    }
+
+    // Passing every hit of the shot to InventoryComponent at once
+    if (IsValid(OwnerInventoryComponent))
+    {
+        OwnerInventoryComponent->OnHitBatch.Broadcast(HitBatch);
+        OwnerInventoryComponent->EventHitBatch.Broadcast(HitBatch);
+    }
+
+    HitBatch.Hits.Reset();
+    HitBatch.Victims.Reset();
+    PendingDamageEvents.Reset();
+}
+
+void AWeaponBase::SpawnImpactEffect(const FHitResult& Hit, const ECosmeticLOD LOD) const
+{
+    // Selecting the hit effect from the surface table based on the hit physical surface, and handing it over to the
+    // impact effect manager, which writes the frame's impacts out in batches
+    UImpactEffectSubsystem* ImpactEffects = GetWorld()->GetSubsystem<UImpactEffectSubsystem>();
+    if (!ImpactEffects || LOD > ECosmeticLOD::Reduced)
+    {
+        return;
+    }
+    
+    const EPhysicalSurface SurfaceType = UPhysicalMaterial::DetermineSurfaceType(Hit.PhysMaterial.Get());
+    const FSurfaceData& Surface = GetSurfaceData(SurfaceType);
+
+    FQueuedImpact Impact;
+    Impact.Location = Hit.ImpactPoint;
+    Impact.Normal = Hit.ImpactNormal;
+    Impact.SurfaceType = SurfaceType;
+    Impact.DataChannel = Surface.ImpactDataChannel;
+    Impact.FallbackEffect = Surface.ImpactEffect ? Surface.ImpactEffect : WeaponData.DefaultHitEffect;
+    ImpactEffects->AddImpact(Impact);
+
+    if (Surface.ImpactDecal && LOD == ECosmeticLOD::Full)
+    {
+        if (UImpactDecalSubsystem* ImpactDecals = GetWorld()->GetSubsystem<UImpactDecalSubsystem>())
+        {
+            ImpactDecals->AddDecal(Hit, SurfaceType, Surface.ImpactDecal, Surface.DecalSize);
+        }
+    }
+}
+
+void AWeaponBase::SetOwner(AActor* NewOwner)
+{
+    Super::SetOwner(NewOwner);
+
+    OwnerInventoryComponent = NewOwner ? NewOwner->FindComponentByClass<UInventoryComponent>() : nullptr;
+}
+
+void AWeaponBase::UpdateTickPrerequisites()
+{
+    APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    AController* Controller = OwnerPawn ? OwnerPawn->GetController() : nullptr;
+    if (TickPrerequisiteController.Get() == Controller && TickDependentOwner.Get() == OwnerPawn)
+    {
+        return;
+    }
+    ClearTickPrerequisites();
+
+    // Input is processed in the controller's tick, so the fire clock has to run after it to see this frame's trigger.
+    // FPS controllers advance the fire clock themselves, just before they turn the view
+    if (Controller)
+    {
+        AddTickPrerequisiteActor(Controller);
+        TickPrerequisiteController = Controller;
+
+        if (AFPSCharacterController* FPSController = Cast<AFPSCharacterController>(Controller))
+        {
+            FPSController->SetActiveWeapon(this);
+        }
+    }
+
+    // The owner recovers from recoil in its tick, so it has to run after this frame's shots have kicked the view. The
+    // controller already ticks before its pawn, so this doesn't create a cycle
+    if (OwnerPawn)
+    {
+        OwnerPawn->AddTickPrerequisiteActor(this);
+        TickDependentOwner = OwnerPawn;
+    }
+}
+
+void AWeaponBase::ClearTickPrerequisites()
+{
+    if (AActor* Controller = TickPrerequisiteController.Get())
+    {
+        RemoveTickPrerequisiteActor(Controller);
+
+        AFPSCharacterController* FPSController = Cast<AFPSCharacterController>(Controller);
+        if (FPSController && FPSController->GetActiveWeapon() == this)
+        {
+            FPSController->SetActiveWeapon(nullptr);
+        }
+    }
+    if (AActor* OwnerActor = TickDependentOwner.Get())
+    {
+        OwnerActor->RemoveTickPrerequisiteActor(this);
+    }
+    TickPrerequisiteController = nullptr;
+    TickDependentOwner = nullptr;
+}
+
+void AWeaponBase::UpdateTickEnabled()
+{
+    const bool bNeedsTick = PrimaryActorTick.IsTickFunctionRegistered()
+                            && (bTriggerHeld || !bIsWeaponReadyToFire || TimeUntilNextShot > 0.0f
+                                || VerticalRecoilTimeline.IsPlaying() || HorizontalRecoilTimeline.IsPlaying()
+                                || bShowDebug);
+    if (bNeedsTick == IsActorTickEnabled())
+    {
+        return;
+    }
+
+    SetActorTickEnabled(bNeedsTick);
+    if (bNeedsTick)
+    {
+        INC_DWORD_STAT(STAT_TickingWeapons);
+    }
+    else
+    {
+        DEC_DWORD_STAT(STAT_TickingWeapons);
+    }
+}
+
+void AWeaponBase::OnEquipped()
+{
+    // Releasing any components from a previous equip, as the attachments (and so the sockets) may have changed since
+    OnHolstered();
+
+    // The components are taken from the pool and kept until the weapon is holstered, so that firing only has to reset them
+    if (WeaponData.MuzzleFlash)
+    {
+        MuzzleFlashComponent = UNiagaraFunctionLibrary::SpawnSystemAttached(WeaponData.MuzzleFlash,
+                                                                            WeaponData.bHasAttachments ? BarrelAttachment : MeshComp,
+                                                                            WeaponData.ParticleSpawnLocation, FVector::ZeroVector,
+                                                                            FRotator::ZeroRotator, EAttachLocation::SnapToTarget,
+                                                                            false, false, ENCPoolMethod::ManualRelease);
+    }
+
+    if (EjectedCasing)
+    {
+        FRotator EjectionSpawnVector = FRotator::ZeroRotator;
+        EjectionSpawnVector.Yaw = 270.0f;
+        static const FName EjectionPortSocket(TEXT("ejection_port"));
+        EjectedCasingComponent = UNiagaraFunctionLibrary::SpawnSystemAttached(EjectedCasing, MagazineAttachment, EjectionPortSocket,
+                                                                              FVector::ZeroVector, EjectionSpawnVector,
+                                                                              EAttachLocation::SnapToTarget, false, false,
+                                                                              ENCPoolMethod::ManualRelease);
+    }
+
+    UpdateTickPrerequisites();
+
+    // Registering our tick again, although it stays disabled until the weapon has something to do
+    RegisterAllActorTickFunctions(true, false);
+    UpdateTickEnabled();
+}
+
+void AWeaponBase::OnHolstered()
+{
+    ClearTickPrerequisites();
+
+    // Holstered weapons can't fire, so they are taken out of the tick lists entirely
+    RegisterAllActorTickFunctions(false, false);
+    UpdateTickEnabled();
+
+    if (FireLoopVoice)
+    {
+        FireLoopVoice->Stop();
+    }
+
+    if (MuzzleFlashComponent)
+    {
+        MuzzleFlashComponent->ReleaseToPool();
+        MuzzleFlashComponent = nullptr;
+    }
+
+    if (EjectedCasingComponent)
+    {
+        EjectedCasingComponent->ReleaseToPool();
+        EjectedCasingComponent = nullptr;
+    }
+}
+
+void AWeaponBase::BeginWarmUp()
+{
+    if (IsNetMode(NM_DedicatedServer))
+    {
+        return;
+    }
+
+    WarmUpQueue.Reset();
+
+    // Gathering every effect that a shot can spawn
+    WarmUpQueue.Add(WeaponData.MuzzleFlash);
+    WarmUpQueue.Add(WeaponData.BulletTrace);
+    WarmUpQueue.Add(WeaponData.BatchedBulletTrace);
+    WarmUpQueue.Add(WeaponData.DefaultHitEffect);
+    WarmUpQueue.Add(EjectedCasing);
+    if (SurfaceLookup.IsValid())
+    {
+        for (const FSurfaceData& Surface : *SurfaceLookup)
+        {
+            WarmUpQueue.AddUnique(Surface.ImpactEffect);
+        }
+    }
+
+    // Gathering the sound waves behind every firing sound, including the ones inside sound cues
+    USoundBase* Sounds[] = {
+        WeaponData.FireSound, WeaponData.SilencedSound, WeaponData.EmptyFireSound, WeaponData.FireLoopSound,
+        WeaponData.FireTailSound, WeaponData.SilencedFireLoopSound, WeaponData.SilencedFireTailSound
+    };
+    for (USoundBase* Sound : Sounds)
+    {
+        if (USoundCue* SoundCue = Cast<USoundCue>(Sound))
+        {
+            TArray<USoundNodeWavePlayer*> WavePlayers;
+            SoundCue->RecursiveFindNode<USoundNodeWavePlayer>(SoundCue->FirstNode, WavePlayers);
+            for (const USoundNodeWavePlayer* WavePlayer : WavePlayers)
+            {
+                WarmUpQueue.AddUnique(WavePlayer->GetSoundWave());
+            }
+        }
+        else
+        {
+            WarmUpQueue.AddUnique(Cast<USoundWave>(Sound));
+        }
+    }
+
+    // Gathering the hands' shot montages. The weapon's own shot animations aren't warmed up, as they play in single node
+    // mode, and switching the weapon mesh over to set them up would show their first pose
+    WarmUpQueue.Add(WeaponData.HandsShot);
+    WarmUpQueue.AddUnique(WeaponData.HandsADSShot);
+
+    WarmUpQueue.Remove(nullptr);
+    if (WarmUpQueue.Num() > 0)
+    {
+        GetWorldTimerManager().SetTimerForNextTick(this, &AWeaponBase::WarmUpStep);
+    }
+}
+
+void AWeaponBase::WarmUpStep()
+{
+    const int32 NumAssets = FMath::Min(WarmUpQueue.Num(), FMath::Max(CVarWarmUpAssetsPerFrame.GetValueOnGameThread(), 1));
+    for (int32 Index = 0; Index < NumAssets; ++Index)
+    {
+        UObject* Asset = WarmUpQueue.Pop(EAllowShrinking::No);
+        
+        if (UNiagaraSystem* System = Cast<UNiagaraSystem>(Asset))
+        {
+            // Filling the system's component pool up to its prime size, so that the first shots don't create components
+            if (FNiagaraWorldManager* WorldManager = FNiagaraWorldManager::Get(GetWorld()))
+            {
+                WorldManager->GetComponentPool()->PrimePool(System, GetWorld());
+            }
+        }
+        else if (USoundWave* SoundWave = Cast<USoundWave>(Asset))
+        {
+            // Loading and fully decompressing the wave ahead of its first play
+            if (FAudioDeviceHandle AudioDevice = GetWorld()->GetAudioDevice())
+            {
+                AudioDevice->Precache(SoundWave, false, true, true);
+            }
+        }
+        else if (UAnimMontage* Montage = Cast<UAnimMontage>(Asset))
+        {
+            // Playing the hands montage and stopping it again before the hands next update, so that its montage instance
+            // is set up now rather than during the first shot. It is stopped before it can blend in, so nothing is seen,
+            // and any montage already playing on the hands is left alone
+            const AFPSCharacter* FPSCharacter = Cast<AFPSCharacter>(GetOwner());
+            UAnimInstance* HandsAnimInstance = FPSCharacter && FPSCharacter->GetHandsMesh()
+                                                   ? FPSCharacter->GetHandsMesh()->GetAnimInstance()
+                                                   : nullptr;
+            if (HandsAnimInstance && !HandsAnimInstance->Montage_IsPlaying(Montage))
+            {
+                HandsAnimInstance->Montage_Play(Montage, 1.0f, EMontagePlayReturnType::MontageLength, 0.0f, false);
+                HandsAnimInstance->Montage_Stop(0.0f, Montage);
+            }
+        }
+    }
+
+    if (WarmUpQueue.Num() > 0)
+    {
+        GetWorldTimerManager().SetTimerForNextTick(this, &AWeaponBase::WarmUpStep);
+    }
+}
+
+void AWeaponBase::PlayShotCosmetics(const EShotCosmetics Cosmetics)
+{
+    // Re-triggering the muzzle flash particle
+    if (MuzzleFlashComponent && EnumHasAnyFlags(Cosmetics, EShotCosmetics::MuzzleFlash))
+    {
+        MuzzleFlashComponent->ResetSystem();
+    }
+
+    // Playing the firing sound, unless the firing loop is covering it. The loop is only started if the trigger is still
+    // held, as the cosmetics may have been deferred past StopFire()
+    if (EnumHasAnyFlags(Cosmetics, EShotCosmetics::Sound) && !(bTriggerHeld && StartFireLoop()))
+    {
+        PlayWeaponSound(WeaponData.bSilenced ? WeaponData.SilencedSound : WeaponData.FireSound);
+    }
+
+    // Re-triggering the ejected casing particle
+    if (EjectedCasingComponent && EnumHasAnyFlags(Cosmetics, EShotCosmetics::Casing))
+    {
+        EjectedCasingComponent->ResetSystem();
+    }
+}
+
+ECosmeticLOD AWeaponBase::EvaluateCosmeticLOD() const
+{
+    // Nobody is watching on a dedicated server
+    if (IsNetMode(NM_DedicatedServer))
+    {
+        return ECosmeticLOD::None;
+    }
+
+    // The local player's own weapon is always right in front of them. Every other shooter, bots included, goes through
+    // the distance and visibility bands
+    if (IsHeldByLocalPlayer())
+    {
+        return ECosmeticLOD::Full;
+    }
+
+    const APlayerController* Viewer = GetWorld()->GetFirstPlayerController();
+    if (!Viewer)
+    {
+        return ECosmeticLOD::None;
+    }
+
+    FVector ViewLocation;
+    FRotator ViewRotation;
+    Viewer->GetPlayerViewPoint(ViewLocation, ViewRotation);
+    const double DistanceSquared = FVector::DistSquared(ViewLocation, GetActorLocation());
+
+    if (DistanceSquared > FMath::Square(WeaponData.AudioOnlyDistance))
+    {
+        return ECosmeticLOD::None;
+    }
+    if (DistanceSquared > FMath::Square(WeaponData.ReducedCosmeticsDistance))
+    {
+        return ECosmeticLOD::AudioOnly;
+    }
+
+    // Shooters that haven't been rendered recently are off screen (or hidden behind something), so only their sound
+    // is worth playing
+    if (!MeshComp->WasRecentlyRendered(0.2f))
+    {
+        return ECosmeticLOD::AudioOnly;
+    }
+
+    return DistanceSquared > FMath::Square(WeaponData.FullCosmeticsDistance) ? ECosmeticLOD::Reduced : ECosmeticLOD::Full;
+}
+
+bool AWeaponBase::IsHeldByLocalPlayer() const
+{
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    return OwnerPawn && OwnerPawn->IsPlayerControlled() && OwnerPawn->IsLocallyControlled();
+}
+
+void AWeaponBase::PlayWeaponSound(USoundBase* Sound)
+{
+    if (!Sound || FireVoices.Num() == 0)
+    {
+        return;
+    }
+
+    // Voices are used in turn, so that the one cut off when the pool is full is always the oldest
+    UAudioComponent* Voice = FireVoices[NextFireVoice];
+    NextFireVoice = (NextFireVoice + 1) % FireVoices.Num();
+
+    // Setting the sound of a voice that is still playing restarts it, so it is only set when it changes. Otherwise the
+    // voice would start (and allocate) two active sounds for a single shot
+    if (Voice->Sound != Sound)
+    {
+        Voice->SetSound(Sound);
+    }
+    Voice->Play();
+}
+
+bool AWeaponBase::StartFireLoop()
+{
+    USoundBase* LoopSound = WeaponData.bSilenced ? WeaponData.SilencedFireLoopSound : WeaponData.FireLoopSound;
+    if (!WeaponData.bAutomaticFire || !LoopSound || !FireLoopVoice)
+    {
+        return false;
+    }
+
+    if (!FireLoopVoice->IsPlaying() || FireLoopVoice->Sound != LoopSound)
+    {
+        FireLoopVoice->SetSound(LoopSound);
+        FireLoopVoice->Play();
+    }
+    return true;
+}
+
+void AWeaponBase::StopFireLoop()
+{
+    if (!FireLoopVoice || !FireLoopVoice->IsPlaying())
+    {
+        return;
+    }
+
+    FireLoopVoice->Stop();
+    PlayWeaponSound(WeaponData.bSilenced ? WeaponData.SilencedFireTailSound : WeaponData.FireTailSound);
+}
+
+void AWeaponBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    OnHolstered();
+    
+    Super::EndPlay(EndPlayReason);
+}
+
+const FSurfaceData& AWeaponBase::GetSurfaceData(const EPhysicalSurface SurfaceType) const
+{
+    static const FSurfaceData DefaultSurfaceData;
+    return SurfaceLookup.IsValid() ? (*SurfaceLookup)[SurfaceType] : DefaultSurfaceData;
+}
+
+void AWeaponBase::BuildSurfaceLookup()
+{
+    SurfaceLookup.Reset();
+    if (!WeaponData.SurfaceDataTable)
+    {
+        return;
+    }
+
+    // Flattening the table into an array indexed by surface type, so that resolving a hit is a single lookup rather
+    // than a search through the table's rows. Surfaces without a row keep the defaults, which stop rounds
+    TArray<FSurfaceData> Lookup;
+    Lookup.SetNum(SurfaceType_Max);
+    WeaponData.SurfaceDataTable->ForeachRow<FSurfaceData>(TEXT("BuildSurfaceLookup"), [&Lookup](const FName& RowName, const FSurfaceData& Row)
+    {
+        Lookup[Row.SurfaceType] = Row;
+    });
+    
+    SurfaceLookup = MakeShared<const TArray<FSurfaceData>, ESPMode::ThreadSafe>(MoveTemp(Lookup));
+}
+
+void AWeaponBase::ComputePelletDirections(const FRotator& AimRotation, const int32 InShotSequence,
+                                          const float AccuracyMultiplier, TArray<FVector, TInlineAllocator<16>>& OutDirections)
+{
+    // Reseeding for every shot, so that no shot depends on how many random numbers were drawn before it
+    SpreadStream.Initialize(static_cast<int32>(HashCombine(SpreadSeed, GetTypeHash(InShotSequence))));
+
+    const float PitchVariation = (WeaponData.WeaponPitchVariation + WeaponPitchModifier) * AccuracyMultiplier;
+    const float YawVariation = (WeaponData.WeaponYawVariation + WeaponYawModifier) * AccuracyMultiplier;
+    const int NumberOfPellets = WeaponData.bIsShotgun? WeaponData.ShotgunPellets : 1;
+
+    // Shotguns with a spread pattern transform the whole pattern at once, scaled so that its edge matches the spread
+    if (WeaponData.bIsShotgun && WeaponData.SpreadPattern && WeaponData.SpreadPattern->GetNumPoints() > 0)
+    {
+        const float Roll = WeaponData.SpreadPattern->ShouldRandomiseRotation() ? SpreadStream.FRandRange(0.0f, 2.0f * PI) : 0.0f;
+        WeaponData.SpreadPattern->TransformPattern(AimRotation,
+                                                   FMath::Tan(FMath::DegreesToRadians(FMath::Min(YawVariation, 89.0f))),
+                                                   FMath::Tan(FMath::DegreesToRadians(FMath::Min(PitchVariation, 89.0f))),
+                                                   Roll, NumberOfPellets, OutDirections);
+        return;
+    }
+
+    OutDirections.Reset();
+    for (int i = 0; i < NumberOfPellets; i++)
+    {
+        // Applying randomised variation to the aim
+        FRotator PelletRotation = AimRotation;
+        PelletRotation.Pitch += SpreadStream.FRandRange(-PitchVariation, PitchVariation);
+        PelletRotation.Yaw += SpreadStream.FRandRange(-YawVariation, YawVariation);
+        OutDirections.Add(PelletRotation.Vector());
+    }
+}
+
+void AWeaponBase::BuildShotQueryParams()
+{
+    ShotQueryParams = FCollisionQueryParams(SCENE_QUERY_STAT(FPSCoreShot), UsesComplexTrace(), this);
+    ShotQueryParams.bReturnPhysicalMaterial = true;
+}
+
+ECollisionChannel AWeaponBase::GetShotTraceChannel() const
+{
+    return WeaponData.HitTargetMode == EHitTargetMode::HitboxChannel ? WeaponData.HitboxChannel.GetValue() : ECC_GameTraceChannel1;
+}
+
+bool AWeaponBase::IsHeadshot(const FHitResult& Hit) const
+{
+    if (WeaponData.HitTargetMode == EHitTargetMode::Complex)
+    {
+        return WeaponData.HeadshotDamageSurface && Hit.PhysMaterial.Get() == WeaponData.HeadshotDamageSurface;
+    }
+
+    // Simple collision reports the physics asset body that was hit, while dedicated hitboxes are identified by their tags
+    if (WeaponData.HeadshotBones.Contains(Hit.BoneName))
+    {
+        return true;
+    }
+    
+    const UPrimitiveComponent* HitComponent = Hit.GetComponent();
+    if (HitComponent && HitComponent->ComponentTags.Num() > 0)
+    {
+        for (const FName& HeadshotBone : WeaponData.HeadshotBones)
+        {
+            if (HitComponent->ComponentHasTag(HeadshotBone))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void AWeaponBase::Recoil()
+{
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    APlayerController* PlayerController = OwnerPawn ? Cast<APlayerController>(OwnerPawn->GetController()) : nullptr;
+
+    // Apply recoil by adding the baked pitch and yaw of this shot to the controller. Semi-automatic weapons only kick
+    // on the first shot of each trigger pull
+    if (PlayerController && RecoilTable.Num() > 0 && (WeaponData.bAutomaticFire || ShotsFired <= 0))
+    {
+        const FVector2f Kick = RecoilTable.GetKick(ShotsFired);
+
+        // Kicking the view through look input, so that it is scaled and processed (view pitch limits, camera modifiers)
+        // like the player's own input. FPS controllers turn the view after firing the frame's shots, so the kick is in
+        // the camera of the frame that the shot was fired in
+        if (AFPSCharacterController* FPSController = Cast<AFPSCharacterController>(PlayerController))
+        {
+            FPSController->AddRecoilInput(Kick.X, Kick.Y);
+        }
+        else
+        {
+            PlayerController->AddPitchInput(Kick.X);
+            PlayerController->AddYawInput(Kick.Y);
+        }
+    }
+
+    ShotsFired += 1;
+    if (!PlayerController)
+    {
+        return;
+    }
+
+    // Kicking the owner's camera through their recoil modifier, which only exists for local players. Camera shakes are
+    // only created for weapons that don't have a kick
+    if (!WeaponData.CameraKick.IsZero())
+    {
+        if (PlayerController->IsLocalController())
+        {
+            if (URecoilCameraModifier* RecoilModifier = URecoilCameraModifier::FindOrAdd(PlayerController->PlayerCameraManager))
+            {
+                RecoilModifier->AddKick(WeaponData.CameraKick, WeaponData.CameraKickFrequency);
+            }
+        }
+    }
+    else if (WeaponData.RecoilCameraShake)
+    {
+        PlayerController->ClientStartCameraShake(WeaponData.RecoilCameraShake);
+    }
+}
+
+void AWeaponBase::RecoilRecovery()
+{
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    const AController* Controller = OwnerPawn ? OwnerPawn->GetController() : nullptr;
+    
+    // Releasing the recovery spring from wherever recoil has pushed the view, keeping any velocity it already has. Kicks
+    // that the controller has yet to apply (such as a semi-automatic shot's, recovered from straight after it is fired)
+    // are counted as well, as the view will have been pushed by them before the spring next moves it
+    if (bShouldRecover && Controller)
+    {
+        FRotator PushedRotation = Controller->GetControlRotation();
+        if (const AFPSCharacterController* FPSController = Cast<AFPSCharacterController>(Controller))
+        {
+            PushedRotation += FPSController->GetPendingRecoilInput();
+        }
+        const FRotator Offset = (PushedRotation - ControlRotation).GetNormalized();
+        RecoveryOffset = FVector2D(Offset.Pitch, Offset.Yaw);
+        if (!bRecoveringRecoil)
+        {
+            RecoveryVelocity = FVector2D::ZeroVector;
+        }
+        bRecoveringRecoil = true;
+    }
+}
+
+void AWeaponBase::StopRecoilRecovery()
+{
+    bShouldRecover = false;
+    bRecoveringRecoil = false;
+    RecoveryVelocity = FVector2D::ZeroVector;
+}
+
+/** Advances a damped spring towards zero by the exact solution of x'' = -Stiffness * x - Damping * x', so that the
+ *	result doesn't depend on how the time is split into frames */
+static void StepSpringDamper(double& X, double& V, const double Stiffness, const double Damping, const double DeltaTime)
+{
+    const double Omega = FMath::Sqrt(Stiffness);
+    if (Omega <= UE_SMALL_NUMBER)
+    {
+        X += V * DeltaTime;
+        return;
+    }
+    const double Zeta = Damping / (2.0 * Omega);
+    const double X0 = X;
+    const double V0 = V;
+
+    if (Zeta < 1.0 - UE_KINDA_SMALL_NUMBER)
+    {
+        // Underdamped: an oscillation decaying back to rest
+        const double OmegaD = Omega * FMath::Sqrt(1.0 - Zeta * Zeta);
+        const double Decay = FMath::Exp(-Zeta * Omega * DeltaTime);
+        double Sin, Cos;
+        FMath::SinCos(&Sin, &Cos, OmegaD * DeltaTime);
+        X = Decay * (X0 * Cos + (V0 + Zeta * Omega * X0) / OmegaD * Sin);
+        V = Decay * (V0 * Cos - (Zeta * Omega * V0 + Omega * Omega * X0) / OmegaD * Sin);
+    }
+    else if (Zeta > 1.0 + UE_KINDA_SMALL_NUMBER)
+    {
+        // Overdamped: the sum of two decaying exponentials
+        const double Root = FMath::Sqrt(Zeta * Zeta - 1.0);
+        const double R1 = -Omega * (Zeta - Root);
+        const double R2 = -Omega * (Zeta + Root);
+        const double A = (V0 - R2 * X0) / (R1 - R2);
+        const double B = X0 - A;
+        const double E1 = FMath::Exp(R1 * DeltaTime);
+        const double E2 = FMath::Exp(R2 * DeltaTime);
+        X = A * E1 + B * E2;
+        V = A * R1 * E1 + B * R2 * E2;
+    }
+    else
+    {
+        // Critically damped: the fastest return without overshooting
+        const double Decay = FMath::Exp(-Omega * DeltaTime);
+        const double C = V0 + Omega * X0;
+        X = (X0 + C * DeltaTime) * Decay;
+        V = (V0 - Omega * C * DeltaTime) * Decay;
+    }
+}
+
+void AWeaponBase::UpdateRecoilRecovery(const float DeltaTime)
+{
+    if (!bRecoveringRecoil)
+    {
+        return;
+    }
+
+    const APawn* OwnerPawn = Cast<APawn>(GetOwner());
+    AController* Controller = OwnerPawn ? OwnerPawn->GetController() : nullptr;
+    if (!Controller)
+    {
+        StopRecoilRecovery();
+        return;
+    }
+
+    const FVector2D PreviousOffset = RecoveryOffset;
+    StepSpringDamper(RecoveryOffset.X, RecoveryVelocity.X, RecoveryStiffness, RecoveryDamping, DeltaTime);
+    StepSpringDamper(RecoveryOffset.Y, RecoveryVelocity.Y, RecoveryStiffness, RecoveryDamping, DeltaTime);
+
+    // Moving the view by how much the spring moved this frame, so that any other changes to the view are kept
+    const FVector2D Delta = RecoveryOffset - PreviousOffset;
+    Controller->SetControlRotation(Controller->GetControlRotation() + FRotator(Delta.X, Delta.Y, 0.0));
+
+    // Stopping once the spring has settled
+    if (RecoveryOffset.SizeSquared() < FMath::Square(0.01) && RecoveryVelocity.SizeSquared() < FMath::Square(0.01))
+    {
+        bRecoveringRecoil = false;
+        RecoveryVelocity = FVector2D::ZeroVector;
+    }
+}
+
+
+bool AWeaponBase::Reload()
+{
+    if (!bCanReload)
+    {
+        return false;
+    }
+
+    // Cutting the firing loop off, as the weapon can't fire while reloading
+    StopFireLoop();
+
+    // Calling a blueprint implementable reload function
+    StartReload();
+    
+    // Casting to the character controller (which stores all the ammunition and health variables)
+    const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
+
+    // Changing the maximum ammunition based on if the weapon can hold a bullet in the chamber
+    int Value = 0;
+    if (WeaponData.bCanBeChambered)
+    {
+        Value = 1;
+    }
+
+    // Checking if we are not reloading, if a reloading montage exists, and if there is any point in reloading
+    // (current ammunition does not match maximum magazine capacity and there is spare ammunition to load into the gun)
+    if (CharacterController->AmmoMap.Contains(GeneralWeaponData.AmmoType))
+    {
+        if (!bIsReloading && CharacterController->AmmoMap[GeneralWeaponData.AmmoType] > 0 && (GeneralWeaponData.ClipSize
+            !=
+            (GeneralWeaponData.ClipCapacity + Value)))
+        {
+            // Differentiating between having no ammunition in the magazine (having to chamber a round after reloading)
+            // or not, and playing an animation relevant to that
+            if (GeneralWeaponData.ClipSize <= 0 && WeaponData.EmptyPlayerReload)
+            {
+                if (WeaponData.bHasAttachments)
+                {
+                    MagazineAttachment->PlayAnimation(WeaponData.EmptyWeaponReload, false);
+                }
+                else
+                {
+                    MeshComp->PlayAnimation(WeaponData.EmptyWeaponReload, false);
+                }
+
+                AnimTime = PlayerCharacter->GetHandsMesh()->GetAnimInstance()->Montage_Play(
+                    WeaponData.EmptyPlayerReload, 1.0f);
+            }
+            else if (WeaponData.PlayerReload)
+            {
+                if (WeaponData.bHasAttachments)
+                {
+                    MagazineAttachment->PlayAnimation(WeaponData.WeaponReload, false);
+                }
+                else
+                {
+                    MeshComp->PlayAnimation(WeaponData.WeaponReload, false);
+                }
+                AnimTime = PlayerCharacter->GetHandsMesh()->GetAnimInstance()->Montage_Play(
+                    WeaponData.PlayerReload, 1.0f);
+            }
+            else
+            {
+                AnimTime = 2.0f;
+            }
+
+            // Printing debug strings
+            if (bShowDebug)
+            {
+                GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, "Reload", true);
+            }
+
+            // Setting variables to make sure that the player cannot fire or reload during the time that the weapon is in it's reloading animation
+            bCanFire = false;
+            bIsReloading = true;
+
+            // Starting the timer alongside the animation of the weapon reloading, casting to UpdateAmmo when it finishes
+            GetWorldTimerManager().SetTimer(ReloadingDelay, this, &AWeaponBase::UpdateAmmo, AnimTime, false, AnimTime);
+        }
+    }
+
+    return true;
+}
+
+void AWeaponBase::UpdateAmmo()
+{
+    // Calling a blueprint implementable function signifying the end of a reload
+    FinishReload();
+    
+    // Printing debug strings
+    if(bShowDebug)
+    {
+        GEngine->AddOnScreenDebugMessage(-1, 2.0f, FColor::Red, "UpdateAmmo", true);
+    }
+
+    // Casting to the game instance (which stores all the ammunition and health variables)
+    AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
+    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
     
     // value system to reload the correct amount of bullets if the weapon is using a chambered reloading system
     int Value = 0;
@@ -741,28 +1767,25 @@ void AWeaponBase::UpdateAmmo()
 void AWeaponBase::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+    UpdateTickPrerequisites();
+
+    // Only advances the clock if the owner's controller hasn't already done so this frame
+    AdvanceFireClock(DeltaTime);
         
     VerticalRecoilTimeline.TickTimeline(DeltaTime);
     HorizontalRecoilTimeline.TickTimeline(DeltaTime);
-    RecoilRecoveryTimeline.TickTimeline(DeltaTime);
 
     if (bShowDebug)
     {
-        GEngine->AddOnScreenDebugMessage(-1, DeltaTime, FColor::Green, bHasFiredRecently? TEXT("Has fired recently") : TEXT("Has not fired recently"));
-        GEngine->AddOnScreenDebugMessage(-1, DeltaTime, FColor::Green, bCanFire? TEXT("Can Fire") : TEXT("Can not Fire"));
-        GEngine->AddOnScreenDebugMessage(-1, DeltaTime, FColor::Green, bIsWeaponReadyToFire? TEXT("Weapon is ready to fire") : TEXT("Weapon is not ready to fire"));
+        // Keying the messages to this weapon, so that each frame replaces the last frame's messages rather than adding more
+        const uint64 DebugKey = static_cast<uint64>(GetUniqueID()) << 2;
+        GEngine->AddOnScreenDebugMessage(DebugKey, 0.5f, FColor::Green, bHasFiredRecently? TEXT("Has fired recently") : TEXT("Has not fired recently"));
+        GEngine->AddOnScreenDebugMessage(DebugKey + 1, 0.5f, FColor::Green, bCanFire? TEXT("Can Fire") : TEXT("Can not Fire"));
+        GEngine->AddOnScreenDebugMessage(DebugKey + 2, 0.5f, FColor::Green, bIsWeaponReadyToFire? TEXT("Weapon is ready to fire") : TEXT("Weapon is not ready to fire"));
     }
-}
 
-// Recovering the player's recoil to the pre-fired position
-void AWeaponBase::HandleRecoveryProgress(float Value) const
-{
-    // Getting a reference to the Character Controller
-    const AFPSCharacter* PlayerCharacter = Cast<AFPSCharacter>(UGameplayStatics::GetPlayerCharacter(GetWorld(), 0));
-    AFPSCharacterController* CharacterController = Cast<AFPSCharacterController>(PlayerCharacter->GetController());
-
-    // Calculating the new control rotation by interpolating between current and target 
-    const FRotator NewControlRotation = FMath::Lerp(CharacterController->GetControlRotation(), ControlRotation, Value);
-    
-    CharacterController->SetControlRotation(NewControlRotation);
+    // Switching ourselves off once the fire clock and recoil have settled
+    UpdateTickEnabled();
 }
+
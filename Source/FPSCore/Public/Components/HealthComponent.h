@@ -12,6 +12,10 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_SixParams(FOnHealthChangedSignature, UHealthC
                                              Health, float, HealthDelta, const class UDamageType*, DamageType,
                                              class AController*, InstigatedBy, AActor*, DamageCauser);
 
+/** Delegate broadcast when a round passes close to the owner without hitting them */
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_FourParams(FOnSuppressedSignature, UHealthComponent*, HealthComponent, float,
+                                              Suppression, FVector, ClosestPoint, AActor*, Instigator);
+
 UCLASS( ClassGroup=(Isolation), meta=(BlueprintSpawnableComponent) )
 class FPSCORE_API UHealthComponent : public UActorComponent
 {
@@ -24,6 +28,11 @@ public:
 	/** Implementation of our delegate  */
 	UPROPERTY(BlueprintAssignable, Category = "Events")
 	FOnHealthChangedSignature OnHealthChanged;
+
+	/** Broadcast at most once per frame when rounds pass close to the owner, with the closest of them. Suppression runs
+	 *	from 0 at the edge of fps.NearMiss.Radius to 1 for a round straight through */
+	UPROPERTY(BlueprintAssignable, Category = "Events")
+	FOnSuppressedSignature OnSuppressed;
 	
 protected:
 	/** Called when the game starts */
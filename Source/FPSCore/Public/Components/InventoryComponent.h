@@ -14,6 +14,8 @@ class UCameraComponent;
 class UInventoryComponent;
 
 DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE_OneParam(FHitActor, UInventoryComponent, EventHitActor, FHitResult, HitResult);
+DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE_OneParam(FHitBatchEvent, UInventoryComponent, EventHitBatch, const FHitBatch&, HitBatch);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnHitBatch, const FHitBatch& /* HitBatch */);
 DECLARE_DYNAMIC_MULTICAST_SPARSE_DELEGATE(FFailedToReload, UInventoryComponent, EventFailedToReload);
 
 UENUM(BlueprintType)
@@ -140,9 +142,17 @@ public:
 		return nullptr;
 	}
 	
+	/** Broadcast once per actor hit by a shot, with the most significant hit on that actor */
 	UPROPERTY(BlueprintAssignable, Category = "Inventory Component")
 	FHitActor EventHitActor;
 
+	/** Broadcast once per shot with every hit that it made */
+	UPROPERTY(BlueprintAssignable, Category = "Inventory Component")
+	FHitBatchEvent EventHitBatch;
+
+	/** Native counterpart to EventHitBatch */
+	FOnHitBatch OnHitBatch;
+
 	UPROPERTY(BlueprintAssignable, Category = "Inventory Component")
 	FFailedToReload EventFailedToReload;
 
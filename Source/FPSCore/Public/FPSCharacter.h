@@ -124,6 +124,13 @@ public:
 	/** Returns a reference to the player's camera component */
 	UCameraComponent* GetCameraComponent() const { return CameraComponent; }
 
+	/** Returns the character's aim at a given point within the current frame, reconstructed from the frame's look input
+	 *	and recoil. Shots are only ever stamped with times within the frame that fired them, so earlier times are
+	 *	treated as the start of the frame
+	 *	@param Time The world time to reconstruct the aim at
+	 */
+	FRotator GetAimRotationAtTime(double Time) const;
+
 	/** Returns the character's empty-handed walking blend space */
 	UFUNCTION(BlueprintPure, Category = "FPS Character")
 	UBlendSpace* GetEmptyWalkBlendSpace() const { return BS_Walk; }
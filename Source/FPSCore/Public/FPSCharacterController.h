@@ -23,4 +23,52 @@ class AFPSCharacterController : public APlayerController
 	/** The amount of ammunition boxes that the player has */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
 	int AmmoBoxCount;
+
+	/** Adds a recoil kick to the view. The kick is scaled like look input, and is applied along with the look input the
+	 *	next time that the view is turned
+	 *	@param Pitch The pitch input of the kick
+	 *	@param Yaw The yaw input of the kick
+	 */
+	void AddRecoilInput(float Pitch, float Yaw);
+
+	/** Returns the recoil kicks that have been added since the view was last turned, which the next turn applies */
+	FRotator GetPendingRecoilInput() const { return PendingRecoilInput; }
+
+	/** Sets the weapon whose fire clock is advanced before the view is turned each frame. Called by the weapon when it is
+	 *	equipped
+	 *	@param Weapon The equipped weapon, or nullptr once it has been holstered
+	 */
+	void SetActiveWeapon(AWeaponBase* Weapon) { ActiveWeapon = Weapon; }
+
+	/** Returns the weapon whose fire clock is advanced before the view is turned each frame */
+	AWeaponBase* GetActiveWeapon() const { return ActiveWeapon.Get(); }
+
+	/** Returns the aim at a point within the current frame: the rotation that the frame started with, turned by the
+	 *	look input received up to that point and by the recoil of every shot fired so far this frame
+	 *	@param Alpha How far into the frame the point is, from 0 at its start to 1 at its end
+	 */
+	FRotator GetAimRotationInFrame(float Alpha) const;
+
+	/** Fires the shots that are due this frame, then turns the view by both the look input and their recoil */
+	virtual void UpdateRotation(float DeltaTime) override;
+
+	private:
+
+	/** The equipped weapon of our pawn */
+	TWeakObjectPtr<AWeaponBase> ActiveWeapon;
+
+	/** The recoil kicks (already scaled like look input) waiting for the next time that the view is turned */
+	FRotator PendingRecoilInput = FRotator::ZeroRotator;
+
+	/** The control rotation before the view was turned this frame */
+	FRotator FrameStartRotation = FRotator::ZeroRotator;
+
+	/** The look input that the view was turned by this frame */
+	FRotator FrameLookInput = FRotator::ZeroRotator;
+
+	/** The recoil that the view was turned by this frame */
+	FRotator FrameRecoilInput = FRotator::ZeroRotator;
+
+	/** The frame in which the view was last turned */
+	uint64 RotationUpdateFrame = 0;
 };
@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "Modules/ModuleManager.h"
+#include "Stats/Stats.h"
+
+/** Stat group for FPS Core's runtime systems (view with 'stat FPSCore') */
+DECLARE_STATS_GROUP(TEXT("FPS Core"), STATGROUP_FPSCore, STATCAT_Advanced);
 
 class FPSCORE_API FFPSCoreModule : public IModuleInterface
 {
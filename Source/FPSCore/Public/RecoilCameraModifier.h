@@ -0,0 +1,41 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Camera/CameraModifier.h"
+#include "RecoilCameraModifier.generated.h"
+
+/** An additive camera kick for weapon recoil. Every shot adds an impulse to a critically damped spring, which is
+ *	evaluated in closed form each frame and added on top of the view rotation. A single modifier lives on each local
+ *	player's camera manager and is shared by all of their weapons, so firing never creates camera shake instances */
+UCLASS()
+class FPSCORE_API URecoilCameraModifier : public UCameraModifier
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Kicks the camera
+	 *	@param Impulse The velocity (in degrees per second) added to the camera's pitch, yaw and roll offset
+	 *	@param Frequency How quickly the camera settles back, in radians per second
+	 */
+	void AddKick(const FRotator& Impulse, float Frequency);
+
+	/** Returns the recoil modifier of a player's camera manager, adding one if it doesn't have one yet
+	 *	@param CameraManager The player's camera manager
+	 */
+	static URecoilCameraModifier* FindOrAdd(APlayerCameraManager* CameraManager);
+
+	/** UCameraModifier implementation */
+	virtual bool ModifyCamera(float DeltaTime, FMinimalViewInfo& InOutPOV) override;
+
+private:
+
+	/** The current offset of the camera and how fast it is changing, as pitch, yaw and roll */
+	FVector Offset = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+
+	/** The frequency of the spring, set by the most recent kick */
+	float SpringFrequency = 20.0f;
+};
@@ -0,0 +1,93 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "SpreadPattern.generated.h"
+
+/** A fixed shotgun spread pattern. Each point is an offset within the unit disk, which is scaled by the weapon's spread
+ *	when fired. Points can be placed by hand or generated as rings or a Poisson-disk distribution */
+UCLASS(BlueprintType)
+class FPSCORE_API USpreadPattern : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Computes the direction of every pellet in a single vectorised pass, by transforming the pattern by the aim basis
+	 *	@param AimRotation The rotation that the shot was aimed at, before spread
+	 *	@param SpreadX The tangent of the horizontal half-angle that the unit disk is scaled to
+	 *	@param SpreadY The tangent of the vertical half-angle that the unit disk is scaled to
+	 *	@param Roll The angle (in radians) by which the pattern is rotated around the aim
+	 *	@param NumPellets The number of pellets to generate. The pattern repeats if it has fewer points than this
+	 *	@param OutDirections The normalised direction of each pellet
+	 */
+	void TransformPattern(const FRotator& AimRotation, float SpreadX, float SpreadY, float Roll, int32 NumPellets,
+	                      TArray<FVector, TInlineAllocator<16>>& OutDirections) const;
+
+	/** Returns the number of points in the pattern */
+	int32 GetNumPoints() const { return Points.Num(); }
+
+	/** Returns the offset of each pellet within the unit disk */
+	const TArray<FVector2D>& GetPoints() const { return Points; }
+
+	/** Replaces the points of the pattern, such as for patterns built at runtime, and bakes them for fire time
+	 *	@param NewPoints The offset of each pellet within the unit disk
+	 */
+	void SetPoints(const TArray<FVector2D>& NewPoints);
+
+	/** Whether the pattern is rotated by a random angle around the aim for every shot */
+	bool ShouldRandomiseRotation() const { return bRandomRotation; }
+
+#if WITH_EDITOR
+	/** Replaces the points with concentric rings: a centre point and NumRings rings with PointsPerRing more points each
+	 *	ring than the last */
+	UFUNCTION(CallInEditor, Category = "Generation")
+	void GenerateRings();
+
+	/** Replaces the points with NumPoints points in a Poisson-disk distribution, using GenerationSeed */
+	UFUNCTION(CallInEditor, Category = "Generation")
+	void GeneratePoissonDisk();
+
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	virtual void PostEditUndo() override;
+#endif
+
+	virtual void PostLoad() override;
+	virtual void PostDuplicate(bool bDuplicateForPIE) override;
+
+private:
+
+	/** Bakes the points into the padded structure-of-arrays buffers used at fire time. Must be called whenever the
+	 *	points change, which is why they can only be set through SetPoints */
+	void BakePoints();
+
+	/** The offset of each pellet within the unit disk */
+	UPROPERTY(EditDefaultsOnly, Category = "Pattern")
+	TArray<FVector2D> Points;
+
+	/** Whether the pattern is rotated by a random angle around the aim for every shot */
+	UPROPERTY(EditDefaultsOnly, Category = "Pattern")
+	bool bRandomRotation = true;
+
+	/** The number of rings generated by GenerateRings */
+	UPROPERTY(EditDefaultsOnly, Category = "Generation", meta=(ClampMin=1))
+	int32 NumRings = 2;
+
+	/** The number of points added to each ring compared to the previous one, for GenerateRings */
+	UPROPERTY(EditDefaultsOnly, Category = "Generation", meta=(ClampMin=1))
+	int32 PointsPerRing = 6;
+
+	/** The number of points generated by GeneratePoissonDisk */
+	UPROPERTY(EditDefaultsOnly, Category = "Generation", meta=(ClampMin=1))
+	int32 NumPoints = 12;
+
+	/** The seed used by GeneratePoissonDisk */
+	UPROPERTY(EditDefaultsOnly, Category = "Generation")
+	int32 GenerationSeed = 0;
+
+	/** The baked X and Y offsets of each point, padded with zeroes to a multiple of four */
+	TArray<float> OffsetsX;
+	TArray<float> OffsetsY;
+};
@@ -0,0 +1,91 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CosmeticSchedulerSubsystem.generated.h"
+
+class AWeaponBase;
+
+/** The cosmetics of a shot that can be scheduled */
+enum class EShotCosmetics : uint8
+{
+	None		= 0,
+	MuzzleFlash	= 1 << 0,
+	Casing		= 1 << 1,
+	Sound		= 1 << 2,
+};
+ENUM_CLASS_FLAGS(EShotCosmetics);
+
+/** The order in which scheduled cosmetics are played. Lower values are played first */
+enum class ECosmeticPriority : uint8
+{
+	LocalPlayer,
+	OnScreen,
+	OffScreen,
+};
+
+/** A shot's cosmetics waiting to be played */
+struct FScheduledCosmetic
+{
+	/** The weapon that fired */
+	TWeakObjectPtr<AWeaponBase> Weapon;
+
+	/** The cosmetics to play. Shots from the same weapon are merged once they are deferred to a later frame */
+	EShotCosmetics Cosmetics = EShotCosmetics::None;
+
+	/** How urgently the cosmetics should be played */
+	ECosmeticPriority Priority = ECosmeticPriority::OffScreen;
+
+	/** The number of frames that the cosmetics have been deferred for. Merged cosmetics count from the newest shot */
+	uint8 FramesDeferred = 0;
+};
+
+/** World-level scheduler for shot cosmetics. Rather than playing muzzle flashes, casings and firing sounds inside Fire(),
+ *	weapons queue them here, and the queue is drained once per frame up to fps.Cosmetics.BudgetMs. The local player's
+ *	cosmetics always play straight away, then on-screen shooters are played before off-screen ones. Whatever misses the
+ *	budget is deferred to the next frame, except off-screen cosmetics, which are dropped, and anything deferred for more
+ *	than fps.Cosmetics.MaxDeferFrames, which is dropped too */
+UCLASS()
+class FPSCORE_API UCosmeticSchedulerSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Queues a shot's cosmetics. Every shot is queued on its own, so that shots within the budget each play in full
+	 *	@param Weapon The weapon that fired
+	 *	@param Cosmetics The cosmetics to play
+	 *	@param Priority How urgently the cosmetics should be played
+	 */
+	void ScheduleCosmetics(AWeaponBase* Weapon, EShotCosmetics Cosmetics, ECosmeticPriority Priority);
+
+	/** Plays queued cosmetics in priority order until the frame's budget runs out. Cosmetics deferred past the budget
+	 *	are merged per weapon, as one muzzle flash and sound can stand in for several late shots */
+	void Drain();
+
+	/** Returns the number of cosmetics deferred to the next frame by the last drain */
+	int32 GetNumDeferred() const { return NumDeferred; }
+
+	/** Returns the number of cosmetics dropped by the last drain */
+	int32 GetNumDropped() const { return NumDropped; }
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Cosmetics waiting to be played */
+	TArray<FScheduledCosmetic> PendingCosmetics;
+
+	/** The cosmetics deferred and dropped by the last drain */
+	int32 NumDeferred = 0;
+	int32 NumDropped = 0;
+};
@@ -0,0 +1,91 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ImpactDecalSubsystem.generated.h"
+
+class UDecalComponent;
+class UMaterialInterface;
+
+/** The number of bullet holes kept on one physical surface */
+USTRUCT()
+struct FPSCORE_API FSurfaceDecalBudget
+{
+	GENERATED_BODY()
+
+	/** The physical surface that this budget applies to */
+	UPROPERTY()
+	TEnumAsByte<EPhysicalSurface> SurfaceType = SurfaceType_Default;
+
+	/** The maximum number of bullet holes kept on this surface, after which the oldest is recycled */
+	UPROPERTY()
+	int32 MaxDecals = 32;
+};
+
+/** World-level manager for bullet hole decals. Decal components are pooled, and each physical surface keeps its decals
+ *	oldest first, capped by a budget shared by every weapon (set in this class's config). Once a surface reaches its
+ *	budget its oldest decal is recycled. The total number of decals across every surface is capped by
+ *	fps.Decals.MaxTotal, and once that is reached the oldest decal in the world is recycled instead, so surfaces that are
+ *	hit later in a match still get decals. The decal count (and memory) stays constant no matter how long a match runs */
+UCLASS(Config=Game)
+class FPSCORE_API UImpactDecalSubsystem final : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Places a decal at the impact, recycling the oldest decal on the surface (or in the world) if a budget is used
+	 *	up. Decals are only placed on static and stationary geometry, as a recycled decal can't follow a moving component
+	 *	@param Hit The hit result of the round
+	 *	@param SurfaceType The physical surface that was hit
+	 *	@param Material The decal material to place
+	 *	@param Size The extent of the decal, with X being its projection depth
+	 */
+	void AddDecal(const FHitResult& Hit, EPhysicalSurface SurfaceType, UMaterialInterface* Material, const FVector& Size);
+
+	/** Returns the number of decal components currently pooled */
+	int32 GetNumDecals() const { return Decals.Num(); }
+
+	/** Builds the budget of every surface from the config */
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Takes the oldest decal off a surface
+	 *	@param SurfaceType The surface to take the decal from
+	 *	@return The index of the decal in Decals
+	 */
+	int32 TakeOldestDecal(EPhysicalSurface SurfaceType);
+
+	/** The budget of surfaces that aren't listed in SurfaceBudgets */
+	UPROPERTY(Config)
+	int32 DefaultSurfaceBudget = 32;
+
+	/** The budget of each listed surface, overriding DefaultSurfaceBudget */
+	UPROPERTY(Config)
+	TArray<FSurfaceDecalBudget> SurfaceBudgets;
+
+	/** Every pooled decal component, across all surfaces */
+	UPROPERTY()
+	TArray<TObjectPtr<UDecalComponent>> Decals;
+
+	/** The order in which each pooled decal was last placed, matching Decals */
+	TArray<uint64> DecalPlacedOrder;
+
+	/** The number of decals placed so far, which orders them by age */
+	uint64 NumPlaced = 0;
+
+	/** The indices into Decals of each physical surface's decals, oldest first */
+	TArray<int32> SurfaceDecals[SurfaceType_Max];
+
+	/** The maximum number of decals kept on each physical surface */
+	int32 SurfaceBudgetLookup[SurfaceType_Max];
+};
@@ -0,0 +1,78 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Chaos/ChaosEngineInterface.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ImpactEffectSubsystem.generated.h"
+
+class UNiagaraDataChannelAsset;
+class UNiagaraSystem;
+
+/** A single impact waiting to be handed to its effect */
+struct FPSCORE_API FQueuedImpact
+{
+	/** The location of the impact */
+	FVector Location = FVector::ZeroVector;
+
+	/** The normal of the surface that was hit */
+	FVector Normal = FVector::UpVector;
+
+	/** The physical surface that was hit */
+	EPhysicalSurface SurfaceType = SurfaceType_Default;
+
+	/** The data channel that the impact is written to. Impacts sharing a channel and a grid cell are written in a
+	 *	single batch */
+	const UNiagaraDataChannelAsset* DataChannel = nullptr;
+
+	/** The system spawned (from the component pool) for the impact when it has no data channel */
+	UNiagaraSystem* FallbackEffect = nullptr;
+};
+
+/** World-level manager for bullet impact effects. Rather than every impact spawning its own Niagara system, impacts are
+ *	collected over the frame and written in one batch per Niagara Data Channel and grid cell, where a persistent system
+ *	per surface renders them. Each batch searches for the channel's data near its own impacts, so that channels split
+ *	into spatial islands receive every impact in the island it landed in. Surfaces without a data channel fall back to
+ *	pooled system spawns */
+UCLASS()
+class FPSCORE_API UImpactEffectSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Queues an impact effect, to be written out at the next flush
+	 *	@param Impact The impact to queue
+	 */
+	void AddImpact(const FQueuedImpact& Impact);
+
+	/** Writes every queued impact to its data channel (or spawns its fallback effect) */
+	void Flush();
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Impacts queued since the last flush */
+	TArray<FQueuedImpact> PendingImpacts;
+
+	/** The grid cell of each pending impact, which together with its data channel decides the batch it is written in */
+	TArray<FIntVector> PendingCells;
+
+	/** The order that the pending impacts are written in, grouped by data channel and then by cell */
+	TArray<int32> WriteOrder;
+
+	/** The number of impacts accepted during ImpactFrame, across every flush in that frame */
+	int32 NumImpactsThisFrame = 0;
+
+	/** The frame that NumImpactsThisFrame was counted in */
+	uint64 ImpactFrame = 0;
+};
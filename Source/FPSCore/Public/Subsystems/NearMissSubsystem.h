@@ -0,0 +1,121 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NearMissSubsystem.generated.h"
+
+class AWeaponBase;
+
+/** A round that passed close to a player without hitting them */
+USTRUCT(BlueprintType)
+struct FNearMissEvent
+{
+	GENERATED_BODY()
+
+	/** The player that the round passed */
+	UPROPERTY(BlueprintReadOnly, Category = "Near Miss")
+	APawn* Listener = nullptr;
+
+	/** The actor that fired the round */
+	UPROPERTY(BlueprintReadOnly, Category = "Near Miss")
+	AActor* Instigator = nullptr;
+
+	/** The closest point of the round's path to the player */
+	UPROPERTY(BlueprintReadOnly, Category = "Near Miss")
+	FVector ClosestPoint = FVector::ZeroVector;
+
+	/** How close the round came, in cm */
+	UPROPERTY(BlueprintReadOnly, Category = "Near Miss")
+	float Distance = 0.0f;
+
+	/** How suppressing the near miss was, from 0 at the edge of fps.NearMiss.Radius to 1 for a round straight through */
+	UPROPERTY(BlueprintReadOnly, Category = "Near Miss")
+	float Suppression = 0.0f;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnNearMiss, const FNearMissEvent& /* NearMiss */);
+
+/** Detects rounds passing close to players, for whizz sounds and suppression. Every segment travelled by a hitscan
+ *	pellet or a projectile during the frame is collected here, and once per frame they are all tested against every
+ *	player's view location. Players are first bucketed into a coarse grid, and each occupied cell only gathers the
+ *	segments whose bounds reach it, into structure-of-arrays buffers that are tested four segments at a time. No
+ *	physics queries are made: a near miss is purely a distance test against the path that the round already traced */
+UCLASS()
+class FPSCORE_API UNearMissSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Adds a segment travelled by a round this frame
+	 *	@param Start The start of the segment
+	 *	@param End The end of the segment
+	 *	@param Weapon The weapon that fired the round
+	 *	@param HitActors Every actor that the round hit, none of which count the round as a near miss
+	 */
+	void AddSegment(const FVector& Start, const FVector& End, AWeaponBase* Weapon, TArrayView<AActor* const> HitActors = {});
+
+	/** Tests every segment added since the last call against every player, and broadcasts the closest near miss for
+	 *	each player that had one */
+	void Process();
+
+	/** Broadcast for every player that a round passed close to, at most once per player per frame. The player's
+	 *	health component broadcasts OnSuppressed as well */
+	FOnNearMiss OnNearMiss;
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** A segment travelled by a round */
+	struct FNearMissSegment
+	{
+		FVector Start;
+		FVector End;
+		TWeakObjectPtr<AWeaponBase> Weapon;
+		TWeakObjectPtr<AActor> Instigator;
+
+		/** The range of PendingHitActors holding the actors that the round hit */
+		int32 FirstHitActor;
+		int32 NumHitActors;
+	};
+
+	/** A player that rounds are tested against */
+	struct FNearMissListener
+	{
+		APawn* Pawn;
+		FVector Location;
+		FIntVector Cell;
+	};
+
+	/** Segments added since the last process */
+	TArray<FNearMissSegment> PendingSegments;
+
+	/** The actors hit by the rounds of the pending segments, which each segment refers to a range of */
+	TArray<TWeakObjectPtr<AActor>> PendingHitActors;
+
+	/** Players gathered for the current process */
+	TArray<FNearMissListener> Listeners;
+
+	/** The segments that reach the cell being processed, relative to the cell's centre and padded to a multiple of four:
+	 *	the start, the vector to the end and the reciprocal of its squared length */
+	TArray<float> StartX;
+	TArray<float> StartY;
+	TArray<float> StartZ;
+	TArray<float> DeltaX;
+	TArray<float> DeltaY;
+	TArray<float> DeltaZ;
+	TArray<float> InvLengthSquared;
+
+	/** The index into PendingSegments of each gathered segment, or INDEX_NONE for padding */
+	TArray<int32> SegmentIndices;
+};
@@ -0,0 +1,131 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Engine/HitResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProjectileSubsystem.generated.h"
+
+class AWeaponBase;
+enum class ECosmeticLOD : uint8;
+
+/** The parameters needed to launch a single simulated projectile */
+struct FPSCORE_API FProjectileLaunchParams
+{
+	/** The weapon that fired this projectile, which receives its hit once it lands */
+	TWeakObjectPtr<AWeaponBase> Weapon;
+
+	/** The location from which the projectile is launched */
+	FVector Origin = FVector::ZeroVector;
+
+	/** The initial velocity of the projectile, in cm/s */
+	FVector Velocity = FVector::ZeroVector;
+
+	/** Quadratic drag coefficient, deceleration is DragCoefficient * speed^2 */
+	float DragCoefficient = 0.0f;
+
+	/** The acceleration due to gravity applied to this projectile, in cm/s^2 */
+	float GravityZ = 0.0f;
+
+	/** How long the projectile lives for before being discarded, in seconds */
+	float Lifetime = 5.0f;
+
+	/** The channel that the projectile's flight path is traced against */
+	ECollisionChannel TraceChannel = ECC_GameTraceChannel1;
+
+	/** Whether the flight path is traced against complex (per-triangle) collision */
+	bool bTraceComplex = false;
+
+	/** How much of the projectile's impact is played, decided when it was fired (Full by default) */
+	ECosmeticLOD CosmeticLOD = {};
+};
+
+/** World-level manager for every live projectile. Rather than spawning an actor per round, projectiles are kept in
+ *	structure-of-arrays buffers which are integrated in one vectorised pass each tick. Only the segment that each
+ *	projectile covered during the frame is traced, and hits are handed back to the firing weapon's damage and impact
+ *	effect code */
+UCLASS()
+class FPSCORE_API UProjectileSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Launches a new projectile
+	 *	@param Params The launch parameters of the projectile
+	 */
+	void LaunchProjectile(const FProjectileLaunchParams& Params);
+
+	/** Returns the number of projectiles currently in flight */
+	int32 GetNumProjectiles() const { return PositionX.Num(); }
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Advances every projectile by DeltaTime, storing the segment each one covered */
+	void Integrate(float DeltaTime);
+
+	/** Traces the segment that each projectile covered this frame */
+	void TraceSegments();
+
+	/** Hands hits back to their weapons and removes projectiles that have landed or expired */
+	void ResolveSegments();
+
+	/** Removes a projectile by swapping the last one into its place
+	 *	@param Index The index of the projectile to remove
+	 */
+	void RemoveProjectile(int32 Index);
+
+	/** Structure-of-arrays projectile state. Every array always holds one entry per live projectile */
+
+	/** The point that each projectile was launched from (the same for every pellet of a shot). Positions are kept as
+	 *	float offsets from it, so that they stay precise however far from the world origin the shot was fired */
+	TArray<FVector> Origin;
+
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+
+	TArray<float> VelocityX;
+	TArray<float> VelocityY;
+	TArray<float> VelocityZ;
+
+	TArray<float> Drag;
+	TArray<float> Gravity;
+	TArray<float> Lifetime;
+
+	TArray<TEnumAsByte<ECollisionChannel>> TraceChannel;
+	TArray<bool> TraceComplex;
+	TArray<TWeakObjectPtr<AWeaponBase>> OwnerWeapon;
+	TArray<ECosmeticLOD> CosmeticLOD;
+
+	/** Per-frame scratch buffers, kept around to avoid reallocating every frame */
+
+	/** The position of each projectile at the start of the frame */
+	TArray<FVector> SegmentStart;
+
+	/** The hit result of each projectile's segment trace */
+	TArray<FHitResult> SegmentHit;
+
+	/** Whether each projectile's segment hit anything */
+	TArray<bool> SegmentBlocked;
+
+	/** The index into OwnerQueryParams of the query parameters used for each projectile's segment trace */
+	TArray<int32> SegmentQueryIndex;
+
+	/** The query parameters of every weapon with projectiles in flight, built once per weapon each frame */
+	TArray<FCollisionQueryParams> OwnerQueryParams;
+
+	/** Maps each weapon (and whether it traces complex collision) to its entry in OwnerQueryParams */
+	TMap<TPair<const AWeaponBase*, bool>, int32> OwnerQueryLookup;
+};
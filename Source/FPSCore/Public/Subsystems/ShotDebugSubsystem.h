@@ -0,0 +1,88 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/LineBatchComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShotDebugSubsystem.generated.h"
+
+class AWeaponBase;
+
+/** Records the debug lines of the last few shots in a fixed ring buffer, and draws them all with a single batched line
+ *	draw each frame. Shots are recorded from weapons with bShowDebug set, or from every weapon while fps.ShotDebug.Enable
+ *	is on. fps.ShotDebug.WeaponFilter and fps.ShotDebug.OwnerFilter limit the drawn shots to weapons and owners whose
+ *	names contain the filter */
+UCLASS()
+class FPSCORE_API UShotDebugSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Whether every weapon's shots should be recorded, rather than just those with bShowDebug set */
+	static bool IsRecordingAllShots();
+
+	/** Starts recording a new shot, overwriting the oldest recorded shot once the buffer is full. Lines added after this
+	 *	belong to the new shot
+	 *	@param Weapon The weapon that fired the shot
+	 */
+	void BeginShot(const AWeaponBase* Weapon);
+
+	/** Adds a line to the shot being recorded
+	 *	@param Start The start of the line
+	 *	@param End The end of the line
+	 *	@param Color The color of the line
+	 */
+	void AddLine(const FVector& Start, const FVector& End, const FColor& Color);
+
+	/** Clears every recorded shot */
+	void Clear();
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** A single line of a recorded shot */
+	struct FShotDebugLine
+	{
+		FVector Start;
+		FVector End;
+		FColor Color;
+	};
+
+	/** A recorded shot. Its lines keep their allocation when the shot is overwritten */
+	struct FRecordedShot
+	{
+		TWeakObjectPtr<const AWeaponBase> Weapon;
+		TWeakObjectPtr<const AActor> Owner;
+		double Time = 0.0;
+		TArray<FShotDebugLine> Lines;
+	};
+
+	/** Whether a shot passes the weapon and owner filters
+	 *	@param Shot The recorded shot
+	 *	@param WeaponFilter The string that the weapon's name must contain, if not empty
+	 *	@param OwnerFilter The string that the owner's name must contain, if not empty
+	 */
+	static bool PassesFilters(const FRecordedShot& Shot, const FString& WeaponFilter, const FString& OwnerFilter);
+
+	/** The ring buffer of recorded shots */
+	TArray<FRecordedShot> Shots;
+
+	/** The shot that is overwritten next */
+	int32 NextShot = 0;
+
+	/** The shot currently being recorded, if any */
+	FRecordedShot* CurrentShot = nullptr;
+
+	/** The lines drawn this frame, kept between frames to avoid reallocating them */
+	TArray<FBatchedLine> BatchedLines;
+};
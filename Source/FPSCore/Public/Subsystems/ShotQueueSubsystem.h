@@ -0,0 +1,132 @@
+// Copyright 2022 Ellie Kelemen. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Engine/HitResult.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShotQueueSubsystem.generated.h"
+
+class AWeaponBase;
+struct FSurfaceData;
+enum class ECosmeticLOD : uint8;
+
+/** A single shot submitted to the shot queue. A shot can be made up of several pellets (for shotguns), all of which
+ *	share the same origin, range and query parameters */
+struct FPSCORE_API FShotRequest
+{
+	/** The weapon that fired this shot, and which receives the results once it has been resolved */
+	TWeakObjectPtr<AWeaponBase> Weapon;
+
+	/** The location from which every pellet of this shot is traced */
+	FVector Origin = FVector::ZeroVector;
+
+	/** The normalised direction of each pellet (the pellet count is the number of directions) */
+	TArray<FVector, TInlineAllocator<16>> Directions;
+
+	/** The distance that each pellet travels */
+	float Range = 0.0f;
+
+	/** The channel that the pellets are traced against */
+	ECollisionChannel TraceChannel = ECC_GameTraceChannel1;
+
+	/** Collision parameters shared by every pellet of this shot */
+	FCollisionQueryParams QueryParams;
+
+	/** The ballistic properties of every physical surface, indexed by EPhysicalSurface. Without it, pellets stop at the
+	 *	first surface they hit */
+	TSharedPtr<const TArray<FSurfaceData>, ESPMode::ThreadSafe> Surfaces;
+
+	/** How much surface thickness (in cm) each pellet can pass through in total */
+	float PenetrationPower = 0.0f;
+
+	/** The maximum number of times that each pellet can ricochet */
+	int32 MaxRicochets = 0;
+
+	/** How much of the shot's tracers and impacts are played, decided when it was fired (Full by default) */
+	ECosmeticLOD CosmeticLOD = {};
+};
+
+/** A single surface hit by a pellet, in the order the pellet reached them */
+struct FPSCORE_API FPelletImpact
+{
+	/** The hit result of the impact */
+	FHitResult Hit;
+
+	/** The direction in which the pellet was travelling when it hit */
+	FVector Direction = FVector::ForwardVector;
+
+	/** The fraction of the weapon's damage that the pellet still carried when it hit */
+	float DamageScale = 1.0f;
+};
+
+/** The resolved trace of a single pellet */
+struct FPSCORE_API FPelletResult
+{
+	/** The start point of the trace */
+	FVector Start = FVector::ZeroVector;
+
+	/** The end point of the pellet's first segment - where it stopped, ricocheted or ran out of range */
+	FVector End = FVector::ZeroVector;
+
+	/** The normalised direction of the pellet */
+	FVector Direction = FVector::ForwardVector;
+
+	/** The end point of every segment after a ricochet, each one starting where the previous one ended */
+	TArray<FVector, TInlineAllocator<2>> RicochetEnds;
+
+	/** Every surface the pellet hit, in order. The pellet stopped at the last one unless it ran out of range */
+	TArray<FPelletImpact, TInlineAllocator<2>> Impacts;
+
+	/** Whether the pellet hit anything */
+	bool bBlockingHit = false;
+
+	/** The index of the shot this pellet belongs to, within the batch being resolved */
+	int32 ShotIndex = INDEX_NONE;
+};
+
+/** World-level queue for hitscan shots. Weapons submit their shots here instead of tracing straight away, and every
+ *	shot fired during a frame is resolved in a single batch - spread across worker threads under one scene read lock -
+ *	before being handed back to the weapon's damage and cosmetics stage later in the same frame */
+UCLASS()
+class FPSCORE_API UShotQueueSubsystem final : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	/** Adds a shot to the queue, to be resolved later this frame
+	 *	@param Request The shot to resolve
+	 */
+	void SubmitShot(FShotRequest&& Request);
+
+	/** Resolves every queued shot immediately and hands the results back to their weapons */
+	void Flush();
+
+	/** Returns the number of shots waiting to be resolved */
+	int32 GetNumPendingShots() const { return PendingShots.Num(); }
+
+	/** FTickableGameObject implementation */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+protected:
+
+	/** Only game worlds fire weapons */
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+
+	/** Shots submitted since the last flush */
+	TArray<FShotRequest> PendingShots;
+
+	/** Shots currently being resolved (swapped with PendingShots so that weapons can safely submit during a flush) */
+	TArray<FShotRequest> ResolvingShots;
+
+	/** Flat list of every pellet in the batch being resolved, kept around to avoid reallocating every frame */
+	TArray<FPelletResult> PelletResults;
+
+	/** One multi-trace hit buffer per parallel task, kept around to avoid reallocating every frame */
+	TArray<TArray<FHitResult>> TraceScratch;
+};
@@ -3,11 +3,14 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
 #include "Camera/CameraShakeBase.h"
 #include "Components/TimelineComponent.h"
 #include "Engine/DataTable.h"
+#include "Engine/DamageEvents.h"
 #include "GameFramework/Actor.h"
 #include "Engine/HitResult.h"
+#include "Chaos/ChaosEngineInterface.h"
 #include "WeaponBase.generated.h"
 
 class AWeaponBase;
@@ -18,11 +21,20 @@ class UAnimMontage;
 class UAnimationAsset;
 class UAnimSequence;
 class UNiagaraSystem;
+class UNiagaraComponent;
+class UNiagaraDataChannelAsset;
+class UMaterialInterface;
 class UBlendSpace;
 class USoundCue;
+class USoundConcurrency;
+class UAudioComponent;
 class UPhysicalMaterial;
 class UDataTable;
 class AWeaponPickup;
+class UInventoryComponent;
+class USpreadPattern;
+enum class EShotCosmetics : uint8;
+struct FPelletResult;
 
 /** Enumerator holding the 4 types of ammunition that weapons can use (used as part of the FSingleWeaponParams struct)
  * and to keep track of the total ammo the player has (ammoMap) */
@@ -35,6 +47,33 @@ enum class EAmmoType : uint8
 	Special		 UMETA(DisplayName = "Special Ammo"),
 };
 
+/** Enumerator holding the ways in which a weapon's rounds can travel */
+UENUM(BlueprintType)
+enum class EBallisticsMode : uint8
+{
+	Hitscan		UMETA(DisplayName = "Hitscan (Instant)"),
+	Projectile	UMETA(DisplayName = "Projectile (Simulated)"),
+};
+
+/** Enumerator holding the collision that a weapon's rounds are traced against */
+UENUM(BlueprintType)
+enum class EHitTargetMode : uint8
+{
+	SimpleCollision	UMETA(DisplayName = "Simple Collision (Physics Asset Primitives)"),
+	HitboxChannel	UMETA(DisplayName = "Dedicated Hitbox Channel"),
+	Complex			UMETA(DisplayName = "Complex Collision (Per-Triangle)"),
+};
+
+/** Enumerator holding how much of a shot's cosmetics are played, from the local viewer's point of view */
+UENUM(BlueprintType)
+enum class ECosmeticLOD : uint8
+{
+	Full		UMETA(DisplayName = "Full (Every Effect, Sound and Animation)"),
+	Reduced		UMETA(DisplayName = "Reduced (No Casings, Decals or Ricochet Tracers, One Tracer Per Shot)"),
+	AudioOnly	UMETA(DisplayName = "Audio Only"),
+	None		UMETA(DisplayName = "None"),
+};
+
 /** Enumerator holding all the possible typed of attachment */
 UENUM()
 enum class EAttachmentType : uint8
@@ -273,10 +312,18 @@ struct FAttachmentData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
 	UCurveFloat* HorizontalRecoilCurve;
 
-	/** The camera shake to be applied to the recoil from this magazine */
+	/** The camera shake to be applied to the recoil from this magazine, only for magazines without a CameraKick */
 	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
 	TSubclassOf<UCameraShakeBase> RecoilCameraShake;
 
+	/** The velocity (in degrees per second) that each shot from this magazine kicks the camera by */
+	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
+	FRotator CameraKick = FRotator::ZeroRotator;
+
+	/** How quickly the camera settles after a kick, in radians per second */
+	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
+	float CameraKickFrequency = 20.0f;
+
 	/** Whether this magazine fires shotgun shells (should we fire lots of pellets or just one bullet?) */
 	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
 	bool bIsShotgun = false;
@@ -289,6 +336,10 @@ struct FAttachmentData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
 	int ShotgunPellets;
 
+	/** The spread pattern of the shotgun shells in this magazine. Pellets are spread randomly if this is not set */
+	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
+	USpreadPattern* SpreadPattern;
+
 	/** The increase in shot variation when the player is not aiming down the sights */
 	UPROPERTY(EditDefaultsOnly, Category = "Magazine", meta=(EditCondition="AttachmentType == EAttachmentType::Magazine"))
 	float AccuracyDebuff = 1.25f;
@@ -346,6 +397,150 @@ struct FAttachmentData : public FTableRowBase
 	float UnmagnifiedLFoV = 200.0f;
 };
 
+/** Struct holding the ballistic properties and impact effects of a physical surface. Rows are looked up by their surface type, so the row
+ *	names themselves are only used for organisation */
+USTRUCT(BlueprintType)
+struct FSurfaceData : public FTableRowBase
+{
+	GENERATED_BODY()
+
+	/** The physical surface that this row describes */
+	UPROPERTY(EditDefaultsOnly, Category = "General")
+	TEnumAsByte<EPhysicalSurface> SurfaceType = SurfaceType_Default;
+
+	/** Whether rounds can pass through this surface */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration")
+	bool bPenetrable = false;
+
+	/** The assumed thickness of this surface, in cm. A round needs at least this much penetration power left to pass
+	 *	through, and loses this much when it does */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration", meta=(EditCondition="bPenetrable"))
+	float Thickness = 10.0f;
+
+	/** The fraction of its damage that a round keeps after passing through this surface */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration", meta=(EditCondition="bPenetrable", ClampMin=0, ClampMax=1))
+	float PenetrationDamageMultiplier = 0.5f;
+
+	/** Whether rounds can glance off this surface */
+	UPROPERTY(EditDefaultsOnly, Category = "Ricochet")
+	bool bCanRicochet = false;
+
+	/** The largest angle between the round's path and the surface, in degrees, at which it will ricochet */
+	UPROPERTY(EditDefaultsOnly, Category = "Ricochet", meta=(EditCondition="bCanRicochet", ClampMin=0, ClampMax=90))
+	float RicochetMaxAngle = 15.0f;
+
+	/** The fraction of its damage that a round keeps after ricocheting off this surface */
+	UPROPERTY(EditDefaultsOnly, Category = "Ricochet", meta=(EditCondition="bCanRicochet", ClampMin=0, ClampMax=1))
+	float RicochetDamageMultiplier = 0.5f;
+
+	/** The Niagara Data Channel that impacts on this surface are written to. Every impact on the channel during a frame
+	 *	is written in one batch, and rendered by whichever persistent systems read from it */
+	UPROPERTY(EditDefaultsOnly, Category = "Effects")
+	UNiagaraDataChannelAsset* ImpactDataChannel;
+
+	/** The effect spawned (from the component pool) for impacts on this surface when it has no data channel */
+	UPROPERTY(EditDefaultsOnly, Category = "Effects")
+	UNiagaraSystem* ImpactEffect;
+
+	/** The bullet hole decal placed on this surface */
+	UPROPERTY(EditDefaultsOnly, Category = "Decals")
+	UMaterialInterface* ImpactDecal;
+
+	/** The extent of the bullet hole decal, with X being its projection depth. How many bullet holes are kept on each
+	 *	surface is shared by every weapon, and set in the impact decal subsystem's config */
+	UPROPERTY(EditDefaultsOnly, Category = "Decals")
+	FVector DecalSize = FVector(4.0f, 4.0f, 4.0f);
+};
+
+/** A weapon's recoil baked per shot, with its attachment multipliers already applied. Entry N is the kick of the Nth
+ *	shot of a burst, and shots past the end of the table repeat the last entry, just as the curves hold their last key */
+USTRUCT(BlueprintType)
+struct FRecoilTable
+{
+	GENERATED_BODY()
+
+	/** The pitch input applied by each shot */
+	UPROPERTY(BlueprintReadOnly, Category = "Recoil")
+	TArray<float> Pitch;
+
+	/** The yaw input applied by each shot */
+	UPROPERTY(BlueprintReadOnly, Category = "Recoil")
+	TArray<float> Yaw;
+
+	/** Returns the kick of a shot, with the pitch in X and the yaw in Y
+	 *	@param ShotIndex How many shots into the burst the shot is
+	 */
+	FVector2f GetKick(const int32 ShotIndex) const
+	{
+		if (Pitch.Num() == 0)
+		{
+			return FVector2f::ZeroVector;
+		}
+		const int32 Index = FMath::Clamp(ShotIndex, 0, Pitch.Num() - 1);
+		return FVector2f(Pitch[Index], Yaw[Index]);
+	}
+
+	/** Returns the number of baked shots */
+	int32 Num() const { return Pitch.Num(); }
+};
+
+/** The damage that a single shot dealt to one actor, summed over all of its pellets */
+USTRUCT(BlueprintType)
+struct FHitBatchVictim
+{
+	GENERATED_BODY()
+
+	/** The actor that was damaged */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	TWeakObjectPtr<AActor> Actor;
+
+	/** The total damage dealt to the actor */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	float Damage = 0.0f;
+
+	/** How many pellets hit the actor */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	int32 NumHits = 0;
+
+	/** How many of those hits were headshots */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	int32 NumHeadshots = 0;
+};
+
+/** Every hit from a single shot, delivered in one event rather than one per pellet */
+USTRUCT(BlueprintType)
+struct FHitBatch
+{
+	GENERATED_BODY()
+
+	/** Every surface hit by the shot's pellets, in the order they were resolved */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	TArray<FHitResult> Hits;
+
+	/** The damage dealt to each actor that was hit */
+	UPROPERTY(BlueprintReadOnly, Category = "Hit Batch")
+	TArray<FHitBatchVictim> Victims;
+};
+
+/** Point damage from a whole shot, applied once per victim. HitInfo holds the most significant hit (a headshot if there
+ *	was one), and receivers that only understand point damage can treat it as such */
+struct FPSCORE_API FShotDamageEvent : public FPointDamageEvent
+{
+	/** How many pellets hit the victim */
+	int32 NumHits = 0;
+
+	/** How many of those hits were headshots */
+	int32 NumHeadshots = 0;
+
+	/** The bone hit by each pellet */
+	TArray<FName, TInlineAllocator<16>> HitBones;
+
+	static const int32 ClassID = 101;
+
+	virtual int32 GetTypeID() const override { return FShotDamageEvent::ClassID; }
+	virtual bool IsOfType(const int32 InID) const override { return (FShotDamageEvent::ClassID == InID) || FPointDamageEvent::IsOfType(InID); }
+};
+
 /** Struct holding all required information about the weapon class. This data is set once at tbe beginning of this
  * actor's lifetime, and then remains unchanged for it's duration. It encapsulates all the data regarding the statistics
  * of this weapon, as well as data regarding it's appearance, such as animations and particle effects.
@@ -561,9 +756,19 @@ struct FStaticWeaponData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
 	UCurveFloat* HorizontalRecoilCurve;
 
-	/** The camera shake to be applied to the recoil from this weapon */
+	/** The camera shake to be applied to the recoil from this weapon. Creating a shake for every shot is expensive, so
+	 *	this is only played for weapons without a CameraKick, for special cases that need a bespoke shake */
 	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
 	TSubclassOf<UCameraShakeBase> RecoilCameraShake;
+
+	/** The velocity (in degrees per second) that each shot kicks the camera by. The kick is added on top of the view by
+	 *	the owner's recoil camera modifier, and settles back without creating any camera shakes */
+	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
+	FRotator CameraKick = FRotator::ZeroRotator;
+
+	/** How quickly the camera settles after a kick, in radians per second */
+	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)", meta=(ClampMin=0))
+	float CameraKickFrequency = 20.0f;
 	
 	/** The range of the shotgun shells of this weapon */
 	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
@@ -573,43 +778,89 @@ struct FStaticWeaponData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
 	int ShotgunPellets;
 
+	/** The spread pattern of this shotgun. Pellets are spread randomly if this is not set */
+	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
+	USpreadPattern* SpreadPattern;
+
 	/** The increase in shot variation when the player is not aiming down the sights */
 	UPROPERTY(EditDefaultsOnly, Category = "Unique Weapon (No Attachments)")
 	float AccuracyDebuff = 1.25f;
 
-	/** Damage surfaces */
+	/** Ballistics */
 
-	/** surface (physical material) for areas which should spawn blood particles when hit and receive normal damage (equivalent to the baseDamage variable) */
-	UPROPERTY(EditDefaultsOnly, Category = "Damage Surfaces")
-	UPhysicalMaterial* NormalDamageSurface;
+	/** Whether this weapon's rounds hit instantly along a line trace, or are simulated as projectiles with travel time, drop and drag */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics")
+	EBallisticsMode BallisticsMode = EBallisticsMode::Hitscan;
+
+	/** The speed at which projectiles leave the barrel, in cm/s */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="BallisticsMode == EBallisticsMode::Projectile"))
+	float MuzzleVelocity = 90000.0f;
+
+	/** Multiplier applied to the world's gravity for projectiles fired by this weapon */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="BallisticsMode == EBallisticsMode::Projectile"))
+	float ProjectileGravityScale = 1.0f;
+
+	/** Quadratic drag coefficient of projectiles fired by this weapon (deceleration is ProjectileDrag * speed^2) */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="BallisticsMode == EBallisticsMode::Projectile"))
+	float ProjectileDrag = 0.0f;
+
+	/** How long a projectile can fly for before it is discarded, in seconds */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="BallisticsMode == EBallisticsMode::Projectile"))
+	float ProjectileLifetime = 3.0f;
+
+	/** What this weapon's rounds are traced against. Simple collision tests the capsules and boxes of physics assets,
+	 *	and is by far the cheapest option. Complex collision tests every triangle of the hit mesh, and should only be
+	 *	used by weapons that need it */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics")
+	EHitTargetMode HitTargetMode = EHitTargetMode::SimpleCollision;
+
+	/** The collision channel that hitboxes respond to, when using the dedicated hitbox channel */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="HitTargetMode == EHitTargetMode::HitboxChannel"))
+	TEnumAsByte<ECollisionChannel> HitboxChannel = ECC_GameTraceChannel2;
+
+	/** Bones (or hitbox component tags) which count as headshots when hit. Used instead of the headshot damage
+	 *	surface unless tracing against complex collision */
+	UPROPERTY(EditDefaultsOnly, Category = "Ballistics", meta=(EditCondition="HitTargetMode != EHitTargetMode::Complex"))
+	TArray<FName> HeadshotBones = { TEXT("head") };
+
+	/** Penetration & Ricochet */
+
+	/** The table which holds the ballistic properties of each physical surface. Surfaces without a row stop rounds */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration & Ricochet")
+	UDataTable* SurfaceDataTable;
+
+	/** How much surface thickness (in cm) a round from this weapon can pass through in total */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration & Ricochet")
+	float PenetrationPower = 0.0f;
+
+	/** The maximum number of times that a round from this weapon can ricochet */
+	UPROPERTY(EditDefaultsOnly, Category = "Penetration & Ricochet", meta=(ClampMin=0))
+	int32 MaxRicochets = 0;
+
+	/** Damage surfaces */
 	
-	/** surface (physical material) for areas which should spawn blood particles when hit and receive boosted damage (equivalent to the baseDamage variable multiplied by the headshotMultiplier) */
+	/** surface (physical material) for areas which should receive boosted damage (equivalent to the baseDamage variable multiplied by the headshotMultiplier)
+	 *	Only used to detect headshots when tracing against complex collision */
 	UPROPERTY(EditDefaultsOnly, Category = "Damage Surfaces")
 	UPhysicalMaterial* HeadshotDamageSurface;
-	
-	/** surface (physical material) for areas which should spawn ground particles when hit) */
-	UPROPERTY(EditDefaultsOnly, Category = "Damage Surfaces")
-	UPhysicalMaterial* GroundSurface;
-	
-	/** surface (physical material) for areas which should spawn rock particles when hit) */
-	UPROPERTY(EditDefaultsOnly, Category = "Damage Surfaces")
-	UPhysicalMaterial* RockSurface;
+
+	/** Cosmetic LOD */
+
+	/** Shots from further away from the local viewer than this (in cm) only play reduced cosmetics */
+	UPROPERTY(EditDefaultsOnly, Category = "Cosmetic LOD")
+	float FullCosmeticsDistance = 3000.0f;
+
+	/** Shots from further away from the local viewer than this (in cm) only play their sound */
+	UPROPERTY(EditDefaultsOnly, Category = "Cosmetic LOD")
+	float ReducedCosmeticsDistance = 8000.0f;
+
+	/** Shots from further away from the local viewer than this (in cm) play no cosmetics at all */
+	UPROPERTY(EditDefaultsOnly, Category = "Cosmetic LOD")
+	float AudioOnlyDistance = 20000.0f;
 
 	/** VFX */
 	
-	/** particle effect (Niagara system) to be spawned when an enemy is hit */
-	UPROPERTY(EditDefaultsOnly, Category = "VFX")
-	UNiagaraSystem* EnemyHitEffect;
-	
-	/** particle effect (Niagara system) to be spawned when the ground is hit */
-	UPROPERTY(EditDefaultsOnly, Category = "VFX")
-	UNiagaraSystem* GroundHitEffect;
-	
-	/** particle effect (Niagara system) to be spawned when a rock is hit */
-	UPROPERTY(EditDefaultsOnly, Category = "VFX")
-	UNiagaraSystem* RockHitEffect;
-	
-	/** particle effect (Niagara system) to be spawned when no defined type is hit */
+	/** particle effect (Niagara system) to be spawned when a surface without an impact effect in the surface table is hit */
 	UPROPERTY(EditDefaultsOnly, Category = "VFX")
 	UNiagaraSystem* DefaultHitEffect;
 
@@ -621,6 +872,13 @@ struct FStaticWeaponData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "VFX")
 	UNiagaraSystem* BulletTrace;
 
+	/** A persistent system that draws every tracer fired by this weapon during a frame, replacing a BulletTrace spawn per
+	 *	pellet. Each upload fills the world-space position arrays User.TracerStarts and User.TracerEnds and the float array
+	 *	User.TracerTimes (the world time each tracer was fired), and increments User.TracerBatch - the system should
+	 *	spawn one tracer per array element whenever the batch changes */
+	UPROPERTY(EditDefaultsOnly, Category = "VFX")
+	UNiagaraSystem* BatchedBulletTrace;
+
 	/** Sound bases */
 
 	/** Firing sound */
@@ -635,6 +893,36 @@ struct FStaticWeaponData : public FTableRowBase
 	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
 	USoundBase* EmptyFireSound;
 
+	/** A looping firing sound, played for as long as an automatic weapon keeps firing in place of a FireSound per shot */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundBase* FireLoopSound;
+
+	/** Played once automatic fire with FireLoopSound stops */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundBase* FireTailSound;
+
+	/** A looping silenced firing sound, played for as long as an automatic weapon keeps firing in place of a
+	 *	SilencedSound per shot */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundBase* SilencedFireLoopSound;
+
+	/** Played once automatic fire with SilencedFireLoopSound stops */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundBase* SilencedFireTailSound;
+
+	/** The whizz heard by a player that this weapon's rounds pass close to */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundBase* NearMissSound;
+
+	/** The number of pooled voices that this weapon plays its firing sounds through. Once they are all in use, the
+	 *	oldest sound is cut off by the next one */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	", meta=(ClampMin=1))
+	int32 NumFireVoices = 4;
+
+	/** The concurrency applied to every firing sound, to limit the number of weapon sounds playing in the world at once */
+	UPROPERTY(EditDefaultsOnly, Category = "Sound bases	")
+	USoundConcurrency* FireSoundConcurrency;
+
 	/** Viewport Appearance */
 
 	/** The name of this weapon, to be used for UI */
@@ -669,10 +957,10 @@ public:
 	 */
 	void SetStaticWeaponData(const FStaticWeaponData NewWeaponData) { WeaponData = NewWeaponData; }
 	
-	/** Starts firing the gun (sets the timer for automatic fire) */
+	/** Starts firing the gun (fires the first shot and starts the fire clock for automatic fire) */
 	void StartFire();
 	
-	/** Stops the timer that allows for automatic fire */
+	/** Stops the fire clock that allows for automatic fire */
 	void StopFire();
 	
 	/** Plays the reload animation and sets a timer based on the length of the reload montage */
@@ -681,6 +969,45 @@ public:
 	/** Spawns the weapons attachments and applies their data/modifications to the weapon's statistics */ 
 	void SpawnAttachments();
 
+	/** Returns the weapon's recoil, baked per shot for its current loadout. Can be used to validate recoil on the server
+	 *	or to preview the weapon's recoil pattern */
+	UFUNCTION(BlueprintPure, Category = "Weapon Base")
+	const FRecoilTable& GetRecoilTable() const { return RecoilTable; }
+
+	/** Creates the persistent muzzle flash and ejected casing components, which are re-triggered on every shot rather
+	 *	than spawned. Called by the inventory whenever the weapon is drawn, after its attachments have been spawned */
+	void OnEquipped();
+
+	/** Returns the muzzle flash and ejected casing components to the pool. Called by the inventory whenever the weapon
+	 *	is put away */
+	void OnHolstered();
+
+	/** Warms up everything that the weapon's first shot would otherwise load or create on the spot: its Niagara pools
+	 *	are primed, its sound waves are precached and decompressed and its hands shot montages are instanced. The work
+	 *	is spread over the following frames, fps.WarmUp.AssetsPerFrame assets at a time, so that the warm-up doesn't
+	 *	hitch either. Called by the inventory whenever it spawns a weapon */
+	void BeginWarmUp();
+
+	/** Works out how much of a shot's cosmetics should play for the local viewer, from their distance to the weapon and
+	 *	whether the weapon is on screen. Dedicated servers never play cosmetics, and the local player's own weapon always
+	 *	plays them in full
+	 *	@return The cosmetic LOD to fire the next shot with
+	 */
+	ECosmeticLOD EvaluateCosmeticLOD() const;
+
+	/** Returns whether the weapon is held by a pawn that a local human player controls. AI pawns are locally controlled
+	 *	in standalone and listen server games too, so they are ruled out by checking for a player controller */
+	bool IsHeldByLocalPlayer() const;
+
+	/** Plays a shot's muzzle flash, firing sound and ejected casing. Called by the cosmetic scheduler once the shot's
+	 *	turn comes around within the frame's budget
+	 *	@param Cosmetics The cosmetics to play
+	 */
+	void PlayShotCosmetics(EShotCosmetics Cosmetics);
+
+	/** Returns the cosmetic LOD of the most recent shot */
+	ECosmeticLOD GetCosmeticLOD() const { return CosmeticLOD; }
+
 	/** Whether the weapon can fire or not */
 	bool CanFire() const { return bCanFire; }
 
@@ -702,8 +1029,24 @@ public:
 	 */
 	void SetShouldRecover(const bool bNewShouldRecover) { bShouldRecover = bNewShouldRecover; } 
 
-	/** A reference to the recoil recovery timeline */
-	FTimeline* GetRecoilRecoveryTimeline() { return &RecoilRecoveryTimeline; }
+	/** Stops any recoil recovery in progress, leaving the view where it currently is */
+	void StopRecoilRecovery();
+
+	/** Advances recoil recovery by a frame, moving the owner's view back towards where it was before firing. Called by
+	 *	the owning character once per frame, before it records its aim
+	 *	@param DeltaTime The time since the last update
+	 */
+	void UpdateRecoilRecovery(float DeltaTime);
+
+	/** Whether the weapon is currently recovering from recoil */
+	bool IsRecoveringRecoil() const { return bRecoveringRecoil; }
+
+	/** Advances the fire clock, at most once per frame. The owner's controller calls this just before it turns the view,
+	 *	so that the recoil of every shot fired this frame is in this frame's camera. Our own tick calls it too, for owners
+	 *	whose controller doesn't
+	 *	@param DeltaTime The time elapsed since the last frame
+	 */
+	void AdvanceFireClock(float DeltaTime);
 
 	/** A reference to the key name of the Weapon Data datatable */
 	FString GetDataTableNameRef() const { return DataTableNameRef; }
@@ -712,6 +1055,7 @@ public:
 	void SetShowDebug(const bool IsVisible)
 	{
 		bShowDebug = IsVisible;
+		UpdateTickEnabled();
 	};
 	
 	/** Returns the character's set of animations */
@@ -740,6 +1084,55 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Weapon Base")
 	float GetVerticalCameraOffset() const { return VerticalCameraOffset; }
 
+	/** Applies damage and spawns impact effects for a shot once its pellets have been traced by the shot queue
+	 *	@param Pellets The resolved pellets of the shot
+	 *	@param LOD The cosmetic LOD that the shot was fired at
+	 */
+	void ResolveShot(TArrayView<const FPelletResult> Pellets, ECosmeticLOD LOD);
+
+	/** Applies damage to the hit actor and spawns the relevant impact effect for a single round (used by projectiles)
+	 *	@param Hit The hit result of the round
+	 *	@param ShotDirection The direction in which the round was travelling
+	 *	@param LOD The cosmetic LOD that the round was fired at
+	 *	@param DamageScale The fraction of the weapon's damage that the round still carries
+	 */
+	void ApplyImpact(const FHitResult& Hit, const FVector& ShotDirection, ECosmeticLOD LOD, float DamageScale = 1.0f);
+
+	/** Returns the ballistic properties of a physical surface, from the weapon's surface table
+	 *	@param SurfaceType The surface to look up
+	 */
+	const FSurfaceData& GetSurfaceData(EPhysicalSurface SurfaceType) const;
+
+	/** Computes the direction of every pellet of a shot. Spread is drawn from a stream seeded with the shot's sequence
+	 *	number, so the same aim and sequence number always produce the same pellets, allowing shots to be validated or
+	 *	replayed without sending their directions
+	 *	@param AimRotation The rotation that the shot was aimed at, before spread
+	 *	@param InShotSequence The sequence number of the shot
+	 *	@param AccuracyMultiplier The multiplier applied to the weapon's spread (AccuracyDebuff when not aiming)
+	 *	@param OutDirections The normalised direction of each pellet
+	 */
+	void ComputePelletDirections(const FRotator& AimRotation, int32 InShotSequence, float AccuracyMultiplier,
+	                             TArray<FVector, TInlineAllocator<16>>& OutDirections);
+
+	/** Returns the sequence number that the next shot will use */
+	int32 GetShotSequence() const { return ShotSequence; }
+
+	/** Sets the sequence number of the next shot, for example to resynchronise with a server or a replay
+	 *	@param NewShotSequence The new sequence number
+	 */
+	void SetShotSequence(const int32 NewShotSequence) { ShotSequence = NewShotSequence; }
+
+	/** Returns the collision channel that this weapon's rounds are traced against */
+	ECollisionChannel GetShotTraceChannel() const;
+
+	/** Returns whether this weapon's rounds are traced against complex (per-triangle) collision */
+	bool UsesComplexTrace() const { return WeaponData.HitTargetMode == EHitTargetMode::Complex; }
+
+	/** Returns whether a hit counts as a headshot, based on the hit target mode
+	 *	@param Hit The hit to check
+	 */
+	bool IsHeadshot(const FHitResult& Hit) const;
+
 	UFUNCTION(BlueprintImplementableEvent, Category = "Weapon Base")
 	void GunFired();
 
@@ -774,6 +1167,29 @@ protected:
 	/** The skeletal mesh used to hold the current grip attachment */
 	UPROPERTY(BlueprintReadOnly, Category = "Components")
 	USkeletalMeshComponent* GripAttachment;
+
+	/** The persistent system that draws this weapon's tracers, when it has a BatchedBulletTrace */
+	UPROPERTY(BlueprintReadOnly, Category = "Components")
+	UNiagaraComponent* TracerComponent;
+
+	/** The muzzle flash, attached to the barrel (or the mesh) while the weapon is equipped and reset on every shot */
+	UPROPERTY(BlueprintReadOnly, Category = "Components")
+	UNiagaraComponent* MuzzleFlashComponent;
+
+	/** The ejected casing, attached to the magazine's ejection port while the weapon is equipped and reset on every shot */
+	UPROPERTY(BlueprintReadOnly, Category = "Components")
+	UNiagaraComponent* EjectedCasingComponent;
+
+	/** The pooled voices that single firing sounds (and tails) are played through */
+	UPROPERTY()
+	TArray<UAudioComponent*> FireVoices;
+
+	/** The voice that the next firing sound is played through */
+	int32 NextFireVoice = 0;
+
+	/** The voice that the firing loop is played through */
+	UPROPERTY()
+	UAudioComponent* FireLoopVoice;
 	
 private:
 
@@ -782,8 +1198,19 @@ private:
 	/** Sets default values for this actor's properties */
 	AWeaponBase();
 	
-	/** Spawns the line trace that deals damage and applies sound/visual effects */
-	void Fire();	
+	/** Submits the shot's line traces to the shot queue and applies sound/visual effects
+	 *	@param ShotTime The world time at which the shot was due, which may fall anywhere within the current frame
+	 *	@return Whether a round was fired
+	 */
+	bool Fire(double ShotTime);
+
+	/** Advances the fire clock, emitting every automatic shot that became due during the frame
+	 *	@param DeltaTime The time elapsed since the last frame
+	 */
+	void TickFireClock(float DeltaTime);
+
+	/** Returns the time between two shots, in seconds, based on the weapon's rate of fire */
+	float GetShotInterval() const { return 60.0f / FMath::Max(WeaponData.RateOfFire, 1.0f); }
 
 	/** Applies recoil to the player controller */
 	void Recoil();
@@ -794,25 +1221,91 @@ private:
 	/** Allows the player to fire again */
 	void EnableFire();
 
-	/** Sets the weapon to be allowed to fire */
-	void ReadyToFire();
-
 	/** Begins applying recoil to the weapon */
 	void StartRecoil();
 
 	/** Initiates the recoil function */
 	void RecoilRecovery();
 
-	/** Interpolates the player back to their initial view vector */
-	UFUNCTION()
-	void HandleRecoveryProgress(float Value) const;
-	
+	/** Caches the surface table into a flat array indexed by surface type */
+	void BuildSurfaceLookup();
+
+	/** Builds the query parameters shared by every shot from this weapon */
+	void BuildShotQueryParams();
+
+	/** Adds an impact to the current hit batch, accumulating its damage against the hit actor and spawning its effect
+	 *	@param Hit The hit result of the round
+	 *	@param ShotDirection The direction in which the round was travelling
+	 *	@param DamageScale The fraction of the weapon's damage that the round still carries
+	 *	@param LOD The cosmetic LOD that the round was fired at
+	 */
+	void AddImpactToBatch(const FHitResult& Hit, const FVector& ShotDirection, float DamageScale, ECosmeticLOD LOD);
+
+	/** Applies the accumulated damage once per victim, broadcasts the hit events and resets the batch */
+	void ApplyHitBatch();
+
+	/** Adds a tracer to this frame's batch
+	 *	@param Start The start of the tracer
+	 *	@param End The end of the tracer
+	 */
+	void AddTracer(const FVector& Start, const FVector& End);
+
+	/** Uploads this frame's tracers to the tracer component */
+	void UploadTracers();
+
+	/** Spawns the impact effect for the surface that was hit
+	 *	@param Hit The hit result of the round
+	 *	@param LOD The cosmetic LOD that the round was fired at
+	 */
+	void SpawnImpactEffect(const FHitResult& Hit, ECosmeticLOD LOD) const;
+
 	/** Called when the game starts or when spawned */
 	virtual void BeginPlay() override;
 	
 	/** Called every frame */
 	virtual void Tick(float DeltaTime) override;
 
+	/** Caches the new owner's inventory component, which receives our hit events */
+	virtual void SetOwner(AActor* NewOwner) override;
+
+	/** Orders our tick between the owner's controller and the owner, so that a frame runs input, then the fire clock and
+	 *	recoil, then recoil recovery, before the camera is updated at the end of the frame. Called when the weapon is
+	 *	equipped, and every tick in case the owner was possessed by a different controller since
+	 */
+	void UpdateTickPrerequisites();
+
+	/** Removes the tick ordering set up by UpdateTickPrerequisites. Called when the weapon is holstered */
+	void ClearTickPrerequisites();
+
+	/** Enables our tick only while there is something for it to do: the trigger is held, the fire clock is waiting for
+	 *	the next shot, a recoil timeline is playing or debug messages are shown. Recoil recovery is driven by the owner's
+	 *	tick, so it doesn't need ours. Holstered weapons are unregistered from ticking altogether
+	 */
+	void UpdateTickEnabled();
+
+	/** Bakes the recoil curves, scaled by the attachments' recoil multipliers, into the recoil table. Called once the
+	 *	loadout has been applied in SpawnAttachments */
+	void BakeRecoilTable();
+
+	/** Warms up the next few assets in the warm-up queue, and schedules itself for the next frame until it is empty */
+	void WarmUpStep();
+
+	/** Plays a sound through the next voice in the pool, cutting off the oldest sound if every voice is in use
+	 *	@param Sound The sound to play
+	 */
+	void PlayWeaponSound(USoundBase* Sound);
+
+	/** Starts the firing loop, if the weapon has one and it isn't already playing
+	 *	@return Whether the firing loop is playing in place of a firing sound per shot
+	 */
+	bool StartFireLoop();
+
+	/** Stops the firing loop and plays its tail, if the loop is playing */
+	void StopFireLoop();
+
+	/** Releases the persistent effect components if the weapon is destroyed while equipped */
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 #pragma endregion
 
 #pragma region USER_VARIABLES
@@ -842,9 +1335,14 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Data | Damage")
 	TSubclassOf<UDamageType> DamageType;
 
-	/** The curve for recovery */ 
-	UPROPERTY(EditDefaultsOnly, Category = "Data | Recoil Recovery")
-	UCurveFloat* RecoveryCurve;
+	/** The stiffness of the spring that pulls the view back to where it was before firing. Higher values recover faster */
+	UPROPERTY(EditDefaultsOnly, Category = "Data | Recoil Recovery", meta=(ClampMin=0))
+	float RecoveryStiffness = 100.0f;
+
+	/** The damping of the recovery spring. Twice the square root of the stiffness recovers as fast as possible without
+	 *	overshooting, lower values overshoot and higher values settle more slowly */
+	UPROPERTY(EditDefaultsOnly, Category = "Data | Recoil Recovery", meta=(ClampMin=0))
+	float RecoveryDamping = 20.0f;
 
 	/** The ejected casing particle effect to be played after each shot */
 	UPROPERTY(EditDefaultsOnly, Category = "Particles")
@@ -895,24 +1393,73 @@ private:
 	/** Keeps track of the starting position of the line trace */
 	FVector TraceStart;
 	
-	/** keeps track of the starting rotation of the line trace (required for calculating the trace end point) */
+	/** keeps track of the starting rotation of the line trace (required for calculating the trace direction) */
 	FRotator TraceStartRotation;
-	
-	/** keeps track of the vector direction of the line trace (derived from rotation) */
-	FVector TraceDirection;
-	
-	/** end point of the line trace */
-	FVector TraceEnd;
-
-	/** hit result variable set when a line trace is spawned */
-	UPROPERTY()
-	FHitResult Hit;
 
 	/** internal variable used to keep track of the final damage value after modifications */
 	float FinalDamage;
+
+	/** The ballistic properties of every physical surface, indexed by EPhysicalSurface. Shared with the shot queue,
+	 *	which reads it from worker threads while resolving penetration and ricochets */
+	TSharedPtr<const TArray<FSurfaceData>, ESPMode::ThreadSafe> SurfaceLookup;
+
+	/** The query parameters shared by every shot from this weapon, built once rather than for every shot */
+	FCollisionQueryParams ShotQueryParams;
+
+	/** The assets still waiting to be warmed up */
+	UPROPERTY()
+	TArray<UObject*> WarmUpQueue;
+
+	/** The cosmetic LOD of the most recent shot. Each shot carries its own LOD through to its tracers and impacts, as
+	 *	they can be resolved after later shots have been fired */
+	ECosmeticLOD CosmeticLOD = ECosmeticLOD::Full;
+
+	/** The random stream used for spread, reseeded for every shot */
+	FRandomStream SpreadStream;
+
+	/** The seed shared by every weapon of this type, combined with the shot sequence number to seed each shot */
+	uint32 SpreadSeed = 0;
+
+	/** The sequence number of the next shot */
+	int32 ShotSequence = 0;
+
+	/** The start, end and firing time of every tracer fired this frame, uploaded to the tracer component together */
+	TArray<FVector> TracerStarts;
+	TArray<FVector> TracerEnds;
+	TArray<float> TracerTimes;
+
+	/** The frame that the tracer arrays were filled on */
+	uint64 TracerFrame = 0;
+
+	/** Incremented with every upload, so that the tracer system knows when it has new tracers to spawn */
+	int32 TracerBatch = 0;
+
+	/** The hits of the shot currently being resolved, broadcast as a single event once every pellet has been applied */
+	FHitBatch HitBatch;
+
+	/** The damage accumulated against each victim of the shot currently being resolved, matching HitBatch.Victims */
+	TArray<FShotDamageEvent, TInlineAllocator<8>> PendingDamageEvents;
+
+	/** The owning character's inventory component, cached when the owner is set */
+	UPROPERTY()
+	UInventoryComponent* OwnerInventoryComponent;
+
+	/** The controller that our tick currently waits for, and the owner that currently waits for our tick */
+	TWeakObjectPtr<AActor> TickPrerequisiteController;
+	TWeakObjectPtr<AActor> TickDependentOwner;
 	
-	/** The timer that handles automatic fire */
-	FTimerHandle ShotDelay;
+	/** Whether the trigger is currently held down (between StartFire and StopFire) */
+	bool bTriggerHeld = false;
+
+	/** The time until the fire clock allows the next shot. Negative values carry the time that the clock overshot by
+	 *	into the next frame */
+	float TimeUntilNextShot = 0.0f;
+
+	/** The frame in which the fire clock was last advanced */
+	uint64 FireClockFrame = 0;
+
+	/** The time that the most recent shot was stamped with */
+	double LastShotTime = 0.0;
 	
 	/** The timer that is used when we need to wait for an animation to finish before being able to fire again */
 	FTimerHandle AnimationWaitDelay;
@@ -920,9 +1467,6 @@ private:
 	/** The timer used to keep track of how long a reloading animation takes and only assigning variables */ 
 	FTimerHandle ReloadingDelay;
 
-	/** The timer used to keep track of whether to  */
-	FTimerHandle SpamFirePreventionDelay;
-	
 	/** The curve for vertical recoil (set from WeaponData) */
 	UPROPERTY()
 	UCurveFloat* VerticalRecoilCurve;
@@ -937,15 +1481,19 @@ private:
 	/** The timeline for horizontal recoil (generated from the curve) */
 	FTimeline HorizontalRecoilTimeline;
 
-	/** The timeline for recover (set from the curve) */
-	FTimeline RecoilRecoveryTimeline;
-	
 	/** A value to temporarily cache the player's control rotation so that we can return to it */
 	FRotator ControlRotation;
 
 	/** Keeping track of whether we should do a recoil recovery after finishing firing or not */
 	bool bShouldRecover;
 
+	/** Whether the recovery spring is currently moving the view */
+	bool bRecoveringRecoil = false;
+
+	/** How far the view is from where it was before firing (pitch in X, yaw in Y), and how fast it is moving back */
+	FVector2D RecoveryOffset = FVector2D::ZeroVector;
+	FVector2D RecoveryVelocity = FVector2D::ZeroVector;
+
 	/** Used in recoil to make sure the first shot has properly applied recoil */
 	int ShotsFired;
 	
@@ -954,6 +1502,10 @@ private:
 
 	/** The base multiplier for horizontal recoil, modified by attachments */
 	float HorizontalRecoilModifier = 1.0f;
+
+	/** The recoil of each shot of a burst, baked from the recoil curves for the current loadout */
+	UPROPERTY()
+	FRecoilTable RecoilTable;
 	
 	/** Animation */
 